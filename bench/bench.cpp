@@ -0,0 +1,269 @@
+#include <benchmark/benchmark.h>
+#include <argcpp17.h>
+
+
+// argv built from strings, first entry is the application name
+class command_line {
+public:
+    explicit command_line(std::vector<std::string> tokens)
+        : m_tokens(std::move(tokens))
+    {
+        m_tokens.insert(m_tokens.begin(), "app");
+        for (auto& token : m_tokens)
+            m_args.push_back(token.data());
+    }
+
+    inline int argc() const { return static_cast<int>(m_args.size()); }
+    inline char** args() { return m_args.data(); }
+    inline size_t tokens() const { return m_tokens.size() - 1; }
+
+private:
+    std::vector<std::string> m_tokens;
+    std::vector<char*> m_args;
+};
+
+
+static std::string option_name(size_t index)
+{
+    return "option" + std::to_string(index);
+}
+
+static parser options_schema(size_t options)
+{
+    parser cmdline;
+    cmdline.add_flag({"verbose", "v"}, "verbose output");
+    for (size_t i = 0; i < options; i++)
+        cmdline.add_optional_argument<int>({option_name(i)}, "option");
+    return cmdline;
+}
+
+
+// argv of growing size, every token is a flag or an option with attached value
+static void BM_parse_argv_size(benchmark::State& state)
+{
+    auto cmdline = options_schema(10);
+    std::vector<std::string> tokens;
+    for (int64_t i = 0; i < state.range(0); i++)
+        tokens.push_back(i % 2 ? "v" : "--" + option_name(i % 10) + "=" + std::to_string(i));
+    command_line argv(std::move(tokens));
+
+    for (auto _ : state)
+        cmdline.parse(argv.argc(), argv.args(), parser::view_values);
+    state.SetItemsProcessed(state.iterations() * argv.tokens());
+}
+BENCHMARK(BM_parse_argv_size)->RangeMultiplier(10)->Range(10, 100000);
+
+
+// fixed argv against schemas of growing size
+static void BM_parse_schema_size(benchmark::State& state)
+{
+    auto options = static_cast<size_t>(state.range(0));
+    auto cmdline = options_schema(options);
+    std::vector<std::string> tokens;
+    for (size_t i = 0; i < 10; i++)
+        tokens.push_back("--" + option_name(i * options / 10) + "=1");
+    command_line argv(std::move(tokens));
+
+    for (auto _ : state)
+        cmdline.parse(argv.argc(), argv.args(), parser::view_values);
+    state.SetItemsProcessed(state.iterations() * argv.tokens());
+}
+BENCHMARK(BM_parse_schema_size)->RangeMultiplier(10)->Range(10, 1000);
+
+
+// registering options, including the keyword index and option trie
+static void BM_schema_construction(benchmark::State& state)
+{
+    auto options = static_cast<size_t>(state.range(0));
+    for (auto _ : state) {
+        auto cmdline = options_schema(options);
+        benchmark::DoNotOptimize(cmdline.shared_schema());
+    }
+    state.SetItemsProcessed(state.iterations() * options);
+}
+BENCHMARK(BM_schema_construction)->RangeMultiplier(10)->Range(10, 1000);
+
+// loading the same schema from a saved image into a monotonic buffer
+static void BM_schema_load(benchmark::State& state)
+{
+    auto options = static_cast<size_t>(state.range(0));
+    auto image = options_schema(options).prepare().save();
+    std::vector<std::byte> buffer(image.size() * 2 + 4096);
+    for (auto _ : state) {
+        std::pmr::monotonic_buffer_resource resource(buffer.data(), buffer.size());
+        benchmark::DoNotOptimize(prepared_parser::load(image, &resource));
+    }
+    state.SetItemsProcessed(state.iterations() * options);
+}
+BENCHMARK(BM_schema_load)->RangeMultiplier(10)->Range(10, 1000);
+
+
+// attached (--option=value) versus separated (--option value) values
+static void BM_parse_attached_values(benchmark::State& state)
+{
+    auto cmdline = options_schema(10);
+    std::vector<std::string> tokens;
+    for (size_t i = 0; i < 100; i++)
+        tokens.push_back("--" + option_name(i % 10) + "=" + std::to_string(i));
+    command_line argv(std::move(tokens));
+
+    for (auto _ : state)
+        cmdline.parse(argv.argc(), argv.args(), parser::view_values);
+    state.SetItemsProcessed(state.iterations() * argv.tokens());
+}
+BENCHMARK(BM_parse_attached_values);
+
+static void BM_parse_separated_values(benchmark::State& state)
+{
+    auto cmdline = options_schema(10);
+    std::vector<std::string> tokens;
+    for (size_t i = 0; i < 100; i++) {
+        tokens.push_back("--" + option_name(i % 10));
+        tokens.push_back(std::to_string(i));
+    }
+    command_line argv(std::move(tokens));
+
+    for (auto _ : state)
+        cmdline.parse(argv.argc(), argv.args(), parser::view_values);
+    state.SetItemsProcessed(state.iterations() * argv.tokens());
+}
+BENCHMARK(BM_parse_separated_values);
+
+
+// long positional lists, as produced by response files or xargs
+static void BM_parse_positional_list(benchmark::State& state)
+{
+    auto cmdline = options_schema(10);
+    cmdline.add_positional_list("files", "input files");
+    std::vector<std::string> tokens;
+    for (int64_t i = 0; i < state.range(0); i++)
+        tokens.push_back("src/file" + std::to_string(i) + ".cpp");
+    command_line argv(std::move(tokens));
+    auto schema = cmdline.shared_schema();
+    parse_result result;
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(schema->parse(argv.argc(), argv.args(), result));
+    state.SetItemsProcessed(state.iterations() * argv.tokens());
+}
+BENCHMARK(BM_parse_positional_list)->RangeMultiplier(10)->Range(1000, 100000);
+
+
+// chain of nested subcommands, argv selects the deepest one
+static void BM_parse_subcommand_depth(benchmark::State& state)
+{
+    parser cmdline;
+    std::vector<std::string> tokens;
+    parser* current = &cmdline;
+    for (int64_t i = 0; i < state.range(0); i++) {
+        auto name = "sub" + std::to_string(i);
+        current = &current->add_subcommand(name, "subcommand");
+        tokens.push_back(name);
+    }
+    current->add_flag({"verbose", "v"}, "verbose output");
+    tokens.push_back("v");
+    command_line argv(std::move(tokens));
+
+    for (auto _ : state)
+        cmdline.parse(argv.argc(), argv.args(), parser::view_values);
+    state.SetItemsProcessed(state.iterations() * argv.tokens());
+}
+BENCHMARK(BM_parse_subcommand_depth)->RangeMultiplier(4)->Range(1, 64);
+
+
+// value retrieval, typed options are converted once while parsing
+template<typename T>
+static void get_value(benchmark::State& state, const char* value, bool typed)
+{
+    parser cmdline;
+    if (typed)
+        cmdline.add_optional_argument<T>({"value"}, "value");
+    else
+        cmdline.add_optional_argument({"value"}, "value");
+    command_line argv({"--value", value});
+    cmdline.parse(argv.argc(), argv.args());
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(cmdline.get_value<T>({"value"}));
+}
+
+static void BM_get_value_int(benchmark::State& state, bool typed) { get_value<int>(state, "12345", typed); }
+static void BM_get_value_double(benchmark::State& state, bool typed) { get_value<double>(state, "3.14159", typed); }
+static void BM_get_value_string(benchmark::State& state, bool typed) { get_value<std::string>(state, "some/path/to/file", typed); }
+static void BM_get_value_duration(benchmark::State& state, bool typed) { get_value<std::chrono::milliseconds>(state, "250ms", typed); }
+static void BM_get_value_byte_size(benchmark::State& state, bool typed) { get_value<byte_size>(state, "64MiB", typed); }
+BENCHMARK_CAPTURE(BM_get_value_int, untyped, false);
+BENCHMARK_CAPTURE(BM_get_value_int, typed, true);
+BENCHMARK_CAPTURE(BM_get_value_double, untyped, false);
+BENCHMARK_CAPTURE(BM_get_value_double, typed, true);
+BENCHMARK_CAPTURE(BM_get_value_string, untyped, false);
+BENCHMARK_CAPTURE(BM_get_value_duration, untyped, false);
+BENCHMARK_CAPTURE(BM_get_value_duration, typed, true);
+BENCHMARK_CAPTURE(BM_get_value_byte_size, untyped, false);
+
+// the same reads through handles resolved once
+static void BM_get_value_handle(benchmark::State& state)
+{
+    parser cmdline;
+    cmdline.add_flag({"verbose", "v"}, "verbose output")
+           .add_optional_argument({"batch", "b"}, "batch size");
+    auto verbose = cmdline.get_flag_handle({"verbose"});
+    auto batch = cmdline.get_handle<int>({"batch"});
+    command_line argv({"v", "--batch", "12345"});
+    cmdline.parse(argv.argc(), argv.args());
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(verbose.is_set());
+        benchmark::DoNotOptimize(*batch);
+    }
+}
+BENCHMARK(BM_get_value_handle);
+
+
+// re-parsing with a prepared schema into a reused result
+static void BM_reparse_prepared(benchmark::State& state)
+{
+    auto cmdline = options_schema(10);
+    cmdline.add_positional("input", "input");
+    command_line argv({"v", "--option1=1", "--option2", "2", "--option3=3", "file"});
+    auto schema = cmdline.shared_schema();
+    parse_result result;
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(schema->parse(argv.argc(), argv.args(), result));
+    state.SetItemsProcessed(state.iterations() * argv.tokens());
+}
+BENCHMARK(BM_reparse_prepared);
+
+// same command line through the legacy parser interface
+static void BM_reparse_parser(benchmark::State& state)
+{
+    auto cmdline = options_schema(10);
+    cmdline.add_positional("input", "input");
+    command_line argv({"v", "--option1=1", "--option2", "2", "--option3=3", "file"});
+
+    for (auto _ : state)
+        cmdline.parse(argv.argc(), argv.args());
+    state.SetItemsProcessed(state.iterations() * argv.tokens());
+}
+BENCHMARK(BM_reparse_parser);
+
+// a batch of 100000 command lines against one schema, argument is the number of threads
+static void BM_parse_batch(benchmark::State& state)
+{
+    auto cmdline = options_schema(10);
+    cmdline.add_positional("input", "input");
+    std::vector<std::vector<std::string>> lines(100000);
+    for (size_t i = 0; i < lines.size(); i++)
+        lines[i] = {"v", "--option1=" + std::to_string(i), "--option2", "2", "file" + std::to_string(i)};
+    auto schema = cmdline.shared_schema();
+    batch_result batch;
+
+    for (auto _ : state)
+        schema->parse_batch(lines.begin(), lines.end(), batch, static_cast<unsigned>(state.range(0)));
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(lines.size()));
+}
+BENCHMARK(BM_parse_batch)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+
+
+BENCHMARK_MAIN();
@@ -10,6 +10,11 @@ enum COLOR
     BLUE
 };
 
+template<>
+struct enum_names<COLOR> {
+    static constexpr std::pair<std::string_view, COLOR> values[] = { { "red", RED }, { "green", GREEN }, { "blue", BLUE } };
+};
+
 int main(int argc, char **args)
 {
     parser p;
@@ -22,10 +27,17 @@ int main(int argc, char **args)
     p.add_flag({"flag1", "f1"}, "first flag")
      .add_flag({"flag2", "f2"}, "second flag")
      .add_optional_argument({"option", "o"}, "optional value")
+     .add_optional_argument<COLOR>({"color", "c"}, "color (red, green or blue)")
      .add_mandatory_argument({"mandatory", "m"}, "mandatory value")
      .add_positional("pos1", "first positional")
      .add_positional("pos2", "second positional");
 
+    // the build writes the completion script with argcpp17_add_completion
+    if (argc == 2 && std::string_view(args[1]) == "--bash-completion") {
+        std::cout << p.bash_completion("argcpp17_example");
+        return 0;
+    }
+
     p.parse(argc, args);
 
     return 0;
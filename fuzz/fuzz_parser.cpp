@@ -0,0 +1,441 @@
+#include <argcpp17.h>
+#include <charconv>
+#include <cstring>
+#include <map>
+#include <random>
+
+
+// differential fuzzer: random schemas and argv are parsed by prepared_parser and by parser,
+// and both are checked against a naive reference implementation of the parsing rules
+// built with ARGCPP17_LIBFUZZER it is a libFuzzer target, otherwise main reads inputs from files or
+// stdin (for AFL) or generates random inputs with --random <count>
+
+
+// input bytes, reading past the end yields zeros
+class byte_source {
+public:
+    byte_source(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+    inline uint8_t next() { return m_position < m_size ? m_data[m_position++] : 0; }
+    inline size_t below(size_t count) { return count ? next() % count : 0; }
+    inline bool empty() const { return m_position >= m_size; }
+
+private:
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_position = 0;
+};
+
+
+// names sharing prefixes, so longest match and attached values are exercised
+static const char* names[] = { "a", "b", "ab", "abc", "ba", "v", "verbose", "o", "out", "output", "j", "jobs", "x", "xy" };
+static constexpr size_t name_count = sizeof(names) / sizeof(names[0]);
+
+struct schema_option {
+    std::string key;
+    std::optional<std::string> abbreviation;
+    bool mandatory = false;
+    bool typed = false;
+    bool repeated = false;
+};
+
+struct schema_positional {
+    std::string name;
+    bool typed = false;
+};
+
+struct schema {
+    std::vector<std::pair<std::string, schema>> subcommands;
+    std::vector<std::pair<std::string, std::optional<std::string>>> flags;
+    std::vector<schema_option> options;
+    std::vector<schema_positional> positionals;
+    bool list = false;
+};
+
+
+// keywords of one parser level share an index, so every raw name is used once per level
+static schema make_schema(byte_source& input, size_t depth)
+{
+    schema result;
+    std::vector<std::string> unused(names, names + name_count);
+    auto take = [&]() -> std::optional<std::string> {
+        if (unused.empty())
+            return std::nullopt;
+        auto i = input.below(unused.size());
+        auto name = unused[i];
+        unused.erase(unused.begin() + i);
+        return name;
+    };
+    auto take_abbreviation = [&]() -> std::optional<std::string> {
+        return input.below(2) ? take() : std::nullopt;
+    };
+
+    auto subcommands = depth < 2 ? input.below(3) : 0;
+    for (size_t i = 0; i < subcommands; i++)
+        if (auto name = take())
+            result.subcommands.emplace_back(*name, make_schema(input, depth + 1));
+    auto flags = input.below(4);
+    for (size_t i = 0; i < flags; i++)
+        if (auto name = take())
+            result.flags.emplace_back(*name, take_abbreviation());
+    auto options = input.below(5);
+    for (size_t i = 0; i < options; i++)
+        if (auto name = take()) {
+            schema_option option;
+            option.key = *name;
+            option.abbreviation = take_abbreviation();
+            auto type = input.next();
+            option.mandatory = type & 1;
+            option.typed = type & 2;
+            option.repeated = !option.mandatory && (type & 4);
+            result.options.push_back(option);
+        }
+    auto positionals = input.below(3);
+    for (size_t i = 0; i < positionals; i++)
+        result.positionals.push_back({ "p" + std::to_string(i), input.below(4) == 0 });
+    result.list = input.below(3) == 0;
+    if (result.list)
+        result.positionals.push_back({ "list", false });
+    return result;
+}
+
+static void build_parser(const schema& description, parser& target)
+{
+    for (auto& [name, sub_schema] : description.subcommands)
+        build_parser(sub_schema, target.add_subcommand(name, "subcommand"));
+    for (auto& [key, abbreviation] : description.flags)
+        target.add_flag({ key, abbreviation }, "flag");
+    for (auto& option : description.options) {
+        keyword key(option.key, option.abbreviation);
+        if (option.mandatory && option.typed)
+            target.add_mandatory_argument<int>(key, "option");
+        else if (option.mandatory)
+            target.add_mandatory_argument(key, "option");
+        else if (option.repeated && option.typed)
+            target.add_repeated_argument<int>(key, "option");
+        else if (option.repeated)
+            target.add_repeated_argument(key, "option");
+        else if (option.typed)
+            target.add_optional_argument<int>(key, "option");
+        else
+            target.add_optional_argument(key, "option");
+    }
+    for (size_t i = 0; i < description.positionals.size(); i++) {
+        auto& positional = description.positionals[i];
+        if (description.list && i + 1 == description.positionals.size())
+            target.add_positional_list(positional.name, "list");
+        else if (positional.typed)
+            target.add_positional<int>(positional.name, "positional");
+        else
+            target.add_positional(positional.name, "positional");
+    }
+}
+
+
+// tokens mostly built from the schema names, with values, separators and noise
+static std::vector<std::string> make_tokens(byte_source& input, const schema& description)
+{
+    static const char* values[] = { "1", "-2", "+3", "x", "", "=", ":", "007", "99999999999", "--", "-" };
+    std::vector<std::string> tokens;
+    auto count = input.below(12);
+    for (size_t i = 0; i < count && !input.empty(); i++) {
+        auto name = std::string(names[input.below(name_count)]);
+        auto value = std::string(values[input.below(sizeof(values) / sizeof(values[0]))]);
+        switch (input.below(8)) {
+            case 0: tokens.push_back("--" + name); break;
+            case 1: tokens.push_back("-" + name); break;
+            case 2: tokens.push_back("--" + name + "=" + value); break;
+            case 3: tokens.push_back("--" + name + ":" + value); break;
+            case 4: tokens.push_back("-" + name + value); break;
+            case 5: tokens.push_back(value); break;
+            case 6:
+                if (!description.subcommands.empty()) {
+                    tokens.push_back(description.subcommands[input.below(description.subcommands.size())].first);
+                    break;
+                }
+                [[fallthrough]];
+            default: tokens.push_back(name); break;
+        }
+    }
+    return tokens;
+}
+
+
+// straightforward implementation of the parsing rules, without tries, hashes or filters
+struct outcome {
+    bool ok = true;
+    argcpp17_exception::argcpp17_error error = argcpp17_exception::err_unknown;
+    size_t index = 0;
+    size_t subcommand = parse_result::npos;
+    std::vector<outcome> sub;
+    std::map<std::string, bool> flags;
+    std::map<std::string, std::vector<std::string>> values;
+};
+
+static bool reference_convert(std::string_view value)
+{
+    if (!value.empty() && value.front() == '+')
+        value.remove_prefix(1);
+    int result;
+    auto [end, error] = std::from_chars(value.data(), value.data() + value.length(), result);
+    return error == std::errc() && end == value.data() + value.length() && !value.empty();
+}
+
+static outcome fail(outcome result, argcpp17_exception::argcpp17_error error, size_t index)
+{
+    result.ok = false;
+    result.error = error;
+    result.index = index;
+    return result;
+}
+
+static std::string option_name(const std::string& name, const char* prefix)
+{
+    return name.compare(0, std::strlen(prefix), prefix) == 0 ? name : prefix + name;
+}
+
+static outcome reference_parse(const schema& description, const std::vector<std::string>& tokens, size_t begin)
+{
+    outcome result;
+    if (begin < tokens.size())
+        for (size_t i = 0; i < description.subcommands.size(); i++)
+            if (description.subcommands[i].first == tokens[begin]) {
+                result.subcommand = i;
+                result.sub.push_back(reference_parse(description.subcommands[i].second, tokens, begin + 1));
+                if (!result.sub.front().ok)
+                    return fail(result, result.sub.front().error, result.sub.front().index);
+                return result;
+            }
+
+    auto store = [&result](const schema_option& option, const std::string& value) {
+        auto& values = result.values[option.key];
+        if (!option.repeated)
+            values.clear();
+        values.push_back(value);
+        return !option.typed || reference_convert(value);
+    };
+
+    size_t positional = 0;
+    size_t unknown = parse_result::npos;
+    size_t index = begin;
+    for (; index < tokens.size(); index++) {
+        const std::string& arg = tokens[index];
+
+        const schema_option* option = nullptr;
+        size_t length = 0;
+        for (auto& candidate : description.options) {
+            std::vector<std::string> candidate_names = { option_name(candidate.key, "--") };
+            if (candidate.abbreviation)
+                candidate_names.push_back(option_name(*candidate.abbreviation, "-"));
+            for (auto& name : candidate_names)
+                if (arg.compare(0, name.length(), name) == 0 && name.length() > length) {
+                    option = &candidate;
+                    length = name.length();
+                }
+        }
+        if (option) {
+            std::string value;
+            if (length == arg.length()) {
+                if (++index == tokens.size())
+                    return fail(result, argcpp17_exception::err_missing_value, index - 1);
+                value = tokens[index];
+            } else {
+                value = arg.substr(length);
+                if (value.front() == '=' || value.front() == ':')
+                    value.erase(0, 1);
+            }
+            if (!store(*option, value))
+                return fail(result, argcpp17_exception::err_invalid_value, index);
+            continue;
+        }
+
+        bool flag = false;
+        for (auto& [key, abbreviation] : description.flags)
+            if (arg == key || (abbreviation && arg == *abbreviation)) {
+                result.flags[key] = true;
+                flag = true;
+            }
+        if (flag)
+            continue;
+
+        // clusters of single character flag abbreviations, ending with an option taking the rest
+        std::vector<std::string> cluster_flags;
+        const schema_option* cluster_option = nullptr;
+        size_t cluster_end = 1;
+        bool cluster = arg.length() >= 2 && arg[0] == '-' && arg[1] != '-';
+        for (; cluster && !cluster_option && cluster_end < arg.length(); cluster_end++) {
+            auto name = arg.substr(cluster_end, 1);
+            bool found = false;
+            for (auto& [key, abbreviation] : description.flags)
+                if (abbreviation == name) {
+                    cluster_flags.push_back(key);
+                    found = true;
+                }
+            for (auto& option : description.options)
+                if (option.abbreviation == name) {
+                    cluster_option = &option;
+                    found = true;
+                }
+            cluster = found;
+        }
+        if (cluster) {
+            for (auto& key : cluster_flags)
+                result.flags[key] = true;
+            if (cluster_option) {
+                std::string value = arg.substr(cluster_end);
+                if (value.empty()) {
+                    if (++index == tokens.size())
+                        return fail(result, argcpp17_exception::err_missing_value, index - 1);
+                    value = tokens[index];
+                } else if (value.front() == '=' || value.front() == ':')
+                    value.erase(0, 1);
+                if (!store(*cluster_option, value))
+                    return fail(result, argcpp17_exception::err_invalid_value, index);
+            }
+            continue;
+        }
+
+        if (positional < description.positionals.size()) {
+            auto& target = description.positionals[positional];
+            bool list = description.list && positional + 1 == description.positionals.size();
+            auto& values = result.values[target.name];
+            if (!list)
+                values.clear();
+            values.push_back(arg);
+            if (target.typed && !reference_convert(arg))
+                return fail(result, argcpp17_exception::err_invalid_value, index);
+            if (!list)
+                positional++;
+        } else if (unknown == parse_result::npos)
+            unknown = index;
+    }
+
+    for (auto& option : description.options)
+        if (option.mandatory && !result.values.count(option.key))
+            return fail(result, argcpp17_exception::err_missing_mandatory, index);
+    if (unknown != parse_result::npos)
+        return fail(result, argcpp17_exception::err_unknown_arguments, unknown);
+    if (positional < description.positionals.size() - (description.list ? 1 : 0))
+        return fail(result, argcpp17_exception::err_missing_positionals, index);
+    return result;
+}
+
+
+static void mismatch(const char* what, const std::vector<std::string>& tokens)
+{
+    std::fprintf(stderr, "mismatch in %s for argv:", what);
+    for (auto& token : tokens)
+        std::fprintf(stderr, " '%s'", token.c_str());
+    std::fprintf(stderr, "\n");
+    std::abort();
+}
+
+static void compare(const schema& description, const parse_result& result, const outcome& expected, const std::vector<std::string>& tokens)
+{
+    if (result.ok() != expected.ok)
+        mismatch("status", tokens);
+    if (!expected.ok) {
+        if (result.error() != expected.error || result.error_index() != expected.index)
+            mismatch("error", tokens);
+        return;
+    }
+    if (result.subcommand() != expected.subcommand)
+        mismatch("subcommand", tokens);
+    if (expected.subcommand != parse_result::npos) {
+        compare(description.subcommands[expected.subcommand].second, *result.subcommand_result(), expected.sub.front(), tokens);
+        return;
+    }
+
+    for (auto& [key, abbreviation] : description.flags)
+        if (result.get_flag({ key }) != expected.flags.count(key))
+            mismatch("flag", tokens);
+    auto check_values = [&](const std::string& key, bool all) {
+        auto it = expected.values.find(key);
+        if (all) {
+            auto values = result.get_values({ key });
+            std::vector<std::string> actual(values.begin(), values.end());
+            if (actual != (it == expected.values.end() ? std::vector<std::string>() : it->second))
+                mismatch("values", tokens);
+            return;
+        }
+        auto value = result.get_value<std::string_view>({ key });
+        if (value.has_value() != (it != expected.values.end()) || (value && *value != it->second.back()))
+            mismatch("value", tokens);
+    };
+    for (auto& option : description.options)
+        check_values(option.key, option.repeated);
+    for (size_t i = 0; i < description.positionals.size(); i++)
+        check_values(description.positionals[i].name, description.list && i + 1 == description.positionals.size());
+}
+
+
+static void run_input(const uint8_t* data, size_t size)
+{
+    byte_source input(data, size);
+    auto description = make_schema(input, 0);
+    auto tokens = make_tokens(input, description);
+    auto expected = reference_parse(description, tokens, 0);
+
+    parser cmdline;
+    build_parser(description, cmdline);
+
+    // fast path through the prepared schema
+    auto schema = cmdline.prepare();
+    parse_result result;
+    schema.parse(tokens.begin(), tokens.end(), result);
+    compare(description, result, expected, tokens);
+
+    // parser entry point, which owns its schema and result
+    std::vector<char*> args = { const_cast<char*>("app") };
+    for (auto& token : tokens)
+        args.push_back(const_cast<char*>(token.c_str()));
+    auto status = cmdline.try_parse(static_cast<int>(args.size()), args.data(), parser::view_values);
+    if (status.ok != expected.ok || (!status.ok && (status.error != expected.error || status.index != expected.index)))
+        mismatch("parser status", tokens);
+}
+
+
+#if defined(ARGCPP17_LIBFUZZER)
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    run_input(data, size);
+    return 0;
+}
+#else
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+static void run_stream(std::istream& in)
+{
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    run_input(data.data(), data.size());
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 3 && std::string(argv[1]) == "--random") {
+        // deterministic random inputs, used as smoke test
+        std::mt19937 random(17);
+        auto count = std::stoul(argv[2]);
+        std::vector<uint8_t> data;
+        for (unsigned long i = 0; i < count; i++) {
+            data.resize(random() % 96);
+            for (auto& byte : data)
+                byte = static_cast<uint8_t>(random());
+            run_input(data.data(), data.size());
+        }
+        std::printf("%lu random inputs match the reference\n", count);
+        return 0;
+    }
+
+    // files given as arguments, or a single input on stdin as AFL provides it
+    if (argc == 1)
+        run_stream(std::cin);
+    for (int i = 1; i < argc; i++) {
+        std::ifstream file(argv[i], std::ios::binary);
+        run_stream(file);
+    }
+    return 0;
+}
+#endif
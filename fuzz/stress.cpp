@@ -0,0 +1,83 @@
+#include <argcpp17.h>
+#include <chrono>
+#include <cstring>
+#include <sys/resource.h>
+
+
+// scaling check: parses argv of growing size against schemas of growing size and reports
+// the time per token and the peak RSS, time per token should stay flat in both directions
+// --max-growth <factor> fails if the time per token of the largest run exceeds the smallest by factor
+
+
+static size_t peak_rss_kib()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return static_cast<size_t>(usage.ru_maxrss) / 1024;
+#else
+    return static_cast<size_t>(usage.ru_maxrss);
+#endif
+}
+
+static double nanoseconds_per_token(size_t tokens, size_t options)
+{
+    parser cmdline;
+    cmdline.add_flag({"verbose", "v"}, "verbose output")
+           .add_repeated_argument({"define", "D"}, "definitions")
+           .add_positional_list("files", "input files");
+    for (size_t i = 0; i < options; i++)
+        cmdline.add_optional_argument({"option" + std::to_string(i)}, "option");
+
+    // a mix of flags, attached and separated values and positionals
+    std::vector<std::string> storage;
+    for (size_t i = 0; i < tokens; i++) {
+        switch (i % 4) {
+            case 0: storage.push_back("v"); break;
+            case 1: storage.push_back("--option" + std::to_string(i % options) + "=" + std::to_string(i)); break;
+            case 2: storage.push_back("-D" + std::to_string(i)); break;
+            default: storage.push_back("file" + std::to_string(i)); break;
+        }
+    }
+    std::vector<char*> args = { const_cast<char*>("stress") };
+    for (auto& token : storage)
+        args.push_back(const_cast<char*>(token.c_str()));
+
+    auto schema = cmdline.shared_schema();
+    parse_result result;
+    // repeat small inputs so every measurement covers about a million tokens
+    size_t rounds = std::max<size_t>(1, 1000000 / std::max<size_t>(tokens, 1));
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < rounds; i++)
+        if (!schema->parse(static_cast<int>(args.size()), args.data(), result)) {
+            std::fprintf(stderr, "parse failed: %s\n", argcpp17_exception(result.error()).what());
+            std::exit(1);
+        }
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+    return elapsed.count() / static_cast<double>(rounds * tokens);
+}
+
+int main(int argc, char **argv)
+{
+    double max_growth = 0;
+    if (argc == 3 && std::strcmp(argv[1], "--max-growth") == 0)
+        max_growth = std::stod(argv[2]);
+
+    std::printf("%10s %10s %12s %12s\n", "tokens", "options", "ns/token", "peak KiB");
+    double smallest = 0;
+    double largest = 0;
+    for (size_t tokens = 100; tokens <= 1000000; tokens *= 10)
+        for (size_t options = 10; options <= 10000; options *= 10) {
+            auto time = nanoseconds_per_token(tokens, options);
+            std::printf("%10zu %10zu %12.1f %12zu\n", tokens, options, time, peak_rss_kib());
+            if (!smallest)
+                smallest = time;
+            largest = time;
+        }
+
+    if (max_growth && largest > smallest * max_growth) {
+        std::fprintf(stderr, "time per token grew by %.1fx, more than %.1fx\n", largest / smallest, max_growth);
+        return 1;
+    }
+    return 0;
+}
@@ -3,13 +3,54 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
+#include <sstream>
+#include <algorithm>
 #include <optional>
 #include <memory>
-#include <iostream>
+#include <memory_resource>
+#include <cstddef>
+#include <iosfwd>
 #include <stdexcept>
 #include <functional>
+#include <tuple>
+#include <array>
+#include <utility>
+#include <type_traits>
+#include <charconv>
+#include <chrono>
+#include <any>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <iterator>
+#include <limits>
+#include <unordered_map>
 #include <inttypes.h>
 
+// errors are thrown as argcpp17_exception, without exception support they abort with a message
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+#define ARGCPP17_EXCEPTIONS
+#define ARGCPP17_THROW(error) throw argcpp17_exception(error)
+#else
+#define ARGCPP17_THROW(error) argcpp17_abort(error)
+#endif
+
+// parse statistics are only recorded with ARGCPP17_ENABLE_STATS, otherwise the hooks compile to nothing
+#if defined(ARGCPP17_ENABLE_STATS)
+#define ARGCPP17_STATS(...) __VA_ARGS__
+#else
+#define ARGCPP17_STATS(...)
+#endif
+
+// non-template functions are compiled into the argcpp17 library, unless ARGCPP17_HEADER_ONLY
+// is defined, which makes them inline and includes their definitions in every translation unit
+#if defined(ARGCPP17_HEADER_ONLY)
+#define ARGCPP17_INLINE inline
+#else
+#define ARGCPP17_INLINE
+#endif
+
 // ====================================================
 // DECLARATIONS
 // ====================================================
@@ -17,9 +58,209 @@
 template<typename T>
 T parse_value(const std::string& value);
 
+template<typename T>
+T parse_value(std::string_view value);
+
 template<typename T>
 std::optional<T> parse_value(const std::optional<std::string>& value);
 
+// converts without throwing, returns false if value is no valid T
+template<typename T>
+bool convert_value(std::string_view value, T& result);
+
+template<>
+std::string parse_value(const std::string& value);
+template<>
+std::string parse_value(std::string_view value);
+template<>
+std::string_view parse_value(std::string_view value);
+template<>
+std::optional<std::string> parse_value(const std::optional<std::string>& value);
+
+
+// value converters used by parse_value
+// specialize value_converter<T> to add conversions for own types
+template<typename T, typename Enable = void>
+struct value_converter {
+    // fallback for types providing an istream operator
+    static bool convert(std::string_view value, T& result) {
+        std::istringstream iss{std::string(value)};
+        iss >> result;
+        return !iss.fail() && (iss >> std::ws).eof();
+    }
+};
+
+template<>
+struct value_converter<std::string> {
+    static bool convert(std::string_view value, std::string& result) { result = value; return true; }
+};
+
+template<>
+struct value_converter<std::string_view> {
+    static bool convert(std::string_view value, std::string_view& result) { result = value; return true; }
+};
+
+template<>
+struct value_converter<bool> {
+    static bool convert(std::string_view value, bool& result);
+};
+
+template<>
+struct value_converter<char> {
+    static bool convert(std::string_view value, char& result);
+};
+
+template<typename T>
+struct value_converter<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool> && !std::is_same_v<T, char>>> {
+    static bool convert(std::string_view value, T& result) {
+        // from_chars does not accept a leading plus sign
+        if (!value.empty() && value.front() == '+')
+            value.remove_prefix(1);
+        auto [end, error] = std::from_chars(value.data(), value.data() + value.length(), result);
+        return error == std::errc() && end == value.data() + value.length() && !value.empty();
+    }
+};
+
+template<typename T>
+struct value_converter<T, std::enable_if_t<std::is_floating_point_v<T>>> {
+    static bool convert(std::string_view value, T& result) {
+        if (!value.empty() && value.front() == '+')
+            value.remove_prefix(1);
+#if defined(__cpp_lib_to_chars)
+        auto [end, error] = std::from_chars(value.data(), value.data() + value.length(), result);
+        return error == std::errc() && end == value.data() + value.length() && !value.empty();
+#else
+        // floating point from_chars is not available, strtold needs a terminated copy
+        std::string terminated(value);
+        char* end = nullptr;
+        result = (T) std::strtold(terminated.c_str(), &end);
+        return !terminated.empty() && end == terminated.c_str() + terminated.length();
+#endif
+    }
+};
+
+
+// specialize to parse an enum by name, e.g.:
+// template<> struct enum_names<color> {
+//     static constexpr std::pair<std::string_view, color> values[] = { { "red", red }, { "green", green } };
+// };
+// enums without names are parsed from their underlying integer value
+template<typename E>
+struct enum_names {};
+
+template<typename E, typename = void>
+struct has_enum_names : std::false_type {};
+
+template<typename E>
+struct has_enum_names<E, std::void_t<decltype(enum_names<E>::values)>> : std::true_type {};
+
+template<typename T>
+struct value_converter<T, std::enable_if_t<std::is_enum_v<T>>> {
+    static bool convert(std::string_view value, T& result) {
+        if constexpr (has_enum_names<T>::value) {
+            for (auto& [name, e] : enum_names<T>::values)
+                if (name == value) {
+                    result = e;
+                    return true;
+                }
+            return false;
+        } else {
+            std::underlying_type_t<T> number;
+            if (!value_converter<std::underlying_type_t<T>>::convert(value, number))
+                return false;
+            result = static_cast<T>(number);
+            return true;
+        }
+    }
+};
+
+
+// durations like "250ms", "30s", "5min" or "2h", plain numbers are in units of the duration
+template<typename Rep, typename Period>
+struct value_converter<std::chrono::duration<Rep, Period>> {
+    using duration = std::chrono::duration<Rep, Period>;
+
+    static bool convert(std::string_view value, duration& result) {
+        auto split = std::min(value.find_first_not_of("0123456789.+-"), value.length());
+        auto unit = value.substr(split);
+        Rep count;
+        if (!value_converter<Rep>::convert(value.substr(0, split), count))
+            return false;
+
+        if (unit.empty())
+            result = duration(count);
+        else if (unit == "ns")
+            result = convert_unit<std::nano>(count);
+        else if (unit == "us")
+            result = convert_unit<std::micro>(count);
+        else if (unit == "ms")
+            result = convert_unit<std::milli>(count);
+        else if (unit == "s")
+            result = convert_unit<std::ratio<1>>(count);
+        else if (unit == "min")
+            result = convert_unit<std::ratio<60>>(count);
+        else if (unit == "h")
+            result = convert_unit<std::ratio<3600>>(count);
+        else if (unit == "d")
+            result = convert_unit<std::ratio<86400>>(count);
+        else
+            return false;
+        return true;
+    }
+
+private:
+    template<typename Unit>
+    static duration convert_unit(Rep count) {
+        return std::chrono::duration_cast<duration>(std::chrono::duration<Rep, Unit>(count));
+    }
+};
+
+
+// number of bytes parsed from values like "512", "4KiB", "16M" or "1GB"
+// K, M, G and T as well as KiB, MiB, GiB and TiB are binary units, KB, MB, GB and TB are decimal units
+struct byte_size {
+    uint64_t bytes = 0;
+
+    constexpr byte_size() = default;
+    constexpr explicit byte_size(uint64_t value) : bytes(value) {}
+    constexpr operator uint64_t() const { return bytes; }
+};
+
+template<>
+struct value_converter<byte_size> {
+    static bool convert(std::string_view value, byte_size& result);
+};
+
+// value types whose converters are restored when loading a saved schema, the saved id is the position plus one
+using builtin_value_types = std::tuple<bool, char, signed char, unsigned char, short, unsigned short, int, unsigned int,
+                                       long, unsigned long, long long, unsigned long long, float, double, long double,
+                                       std::string, std::string_view, byte_size,
+                                       std::chrono::nanoseconds, std::chrono::microseconds, std::chrono::milliseconds,
+                                       std::chrono::seconds, std::chrono::minutes, std::chrono::hours>;
+
+// saved id of typed arguments with a type that is not in builtin_value_types
+constexpr uint8_t custom_value_type = UINT8_MAX;
+
+// saved id of T
+template<typename T, size_t I = 0>
+constexpr uint8_t builtin_value_type();
+
+// converts value and stores it as T in cache
+template<typename T>
+bool convert_cached(std::string_view value, std::any& cache);
+
+// converters of builtin_value_types in order
+template<size_t... I>
+constexpr std::array<bool (*)(std::string_view, std::any&), sizeof...(I)> builtin_converters(std::index_sequence<I...>);
+
+// cached arithmetic T as number for range checks
+template<typename T>
+long double cached_number(const std::any& cache);
+
+// cached_number of the arithmetic builtin_value_types in order, nullptr for the others
+template<size_t... I>
+constexpr std::array<long double (*)(const std::any&), sizeof...(I)> builtin_numbers(std::index_sequence<I...>);
+
 // class representing an argcpp17 exception
 class argcpp17_exception : public std::exception
 {
@@ -32,6 +273,17 @@ public:
         err_subcommand_not_found,
         err_missing_mandatory,
         err_missing_positional,
+        err_missing_value,
+        err_invalid_value,
+        err_response_file,
+        err_response_file_depth,
+        err_positional_after_list,
+        err_unknown_keyword,
+        err_config_file,
+        err_subcommand_deferred,
+        err_invalid_schema_image,
+        err_conflicting_arguments,
+        err_missing_requirement,
     };
 
     argcpp17_exception(argcpp17_error error = err_unknown);
@@ -44,21 +296,68 @@ private:
     argcpp17_error m_error;    
 };
 
+// used instead of throwing if exceptions are disabled
+[[noreturn]] void argcpp17_abort(argcpp17_exception::argcpp17_error error);
+
+
+// outcome of an exception free parse
+struct parse_status {
+    bool ok = true;
+    argcpp17_exception::argcpp17_error error = argcpp17_exception::err_unknown;
+    // index of the offending token, or number of tokens if something is missing
+    size_t index = 0;
+
+    inline explicit operator bool() const { return ok; }
+};
+
+
+// measurements of the last parse, all zero unless built with ARGCPP17_ENABLE_STATS
+struct parse_statistics {
+    // time spent classifying and storing tokens, by token kind
+    std::chrono::nanoseconds subcommand_time{0};
+    std::chrono::nanoseconds options_time{0};
+    std::chrono::nanoseconds flags_time{0};
+    std::chrono::nanoseconds positionals_time{0};
+    size_t tokens = 0;
+    // allocations of the parse result, of a schema prepared for the parse
+    // and of the value copies made by copy_values
+    size_t allocations = 0;
+    size_t allocated_bytes = 0;
+    // conversions of typed values while parsing
+    size_t conversions = 0;
+    // index of each selected subcommand in order of registration, outermost first
+    std::vector<size_t> subcommand_path;
+
+    // reset all counters, keeps the capacity of subcommand_path
+    void clear();
+};
+
+
+// callback adding completion candidates for a value starting with prefix
+using value_completer = std::function<void(std::string_view prefix, std::vector<std::string>& candidates)>;
+
 
 // class representing a keyword with optional abbreviation
 class keyword {
 public:
     keyword() = default;
-    keyword(const std::string& key, const std::optional<std::string>& abbreviation = std::nullopt);
-    keyword(const keyword& rhs);
+    keyword(std::string key, std::optional<std::string> abbreviation = std::nullopt);
+    keyword(const keyword& rhs) = default;
+    keyword(keyword&& rhs) noexcept = default;
     ~keyword() = default;
 
-    inline std::string get_key() const { return m_key; }
-    inline std::optional<std::string> get_abbreviation() const { return m_abbreviation; }
+    keyword& operator=(const keyword& rhs) = default;
+    keyword& operator=(keyword&& rhs) noexcept = default;
+
+    inline const std::string& get_key() const { return m_key; }
+    inline const std::optional<std::string>& get_abbreviation() const { return m_abbreviation; }
 
     bool operator==(const keyword& rhs) const;
     bool operator==(const std::string& rhs) const;
 
+    // compare key and abbreviation against a name without creating a string
+    bool matches(std::string_view name) const;
+
 private:
     std::string m_key;
     std::optional<std::string> m_abbreviation;
@@ -66,23 +365,119 @@ private:
 
 
 // ostream operator for keyword
-std::ostream& operator<<(std::ostream& os, const keyword& key) {
-    os << key.get_key();
-    auto abbr = key.get_abbreviation();
-    if (abbr.has_value())
-        os << ", " << abbr.value();
-    return os;
-}
+std::ostream& operator<<(std::ostream& os, const keyword& key);
+
+// class holding an argument value, either as owned copy or as view into caller memory
+class argument_value {
+public:
+    argument_value() = default;
+    argument_value(const argument_value& rhs);
+    argument_value(argument_value&& rhs) noexcept;
+    ~argument_value() = default;
+
+    argument_value& operator=(const argument_value& rhs);
+    argument_value& operator=(argument_value&& rhs) noexcept;
+
+    void assign(std::string_view value);
+    void assign_view(std::string_view value);
+    void clear();
+
+    inline bool has_value() const { return m_has_value; }
+    inline bool is_view() const { return m_has_value && !m_owned; }
+    inline std::string_view view() const { return m_view; }
+
+private:
+    std::string m_storage;
+    std::string_view m_view;
+    bool m_has_value = false;
+    bool m_owned = false;
+};
+
+
+// contiguous values of a repeated argument or positional list, in command line order
+// values are views into the parsed tokens or into the copies of the argument
+class value_list {
+public:
+    value_list() = default;
+    value_list(const std::string_view* begin, const std::string_view* end) : m_begin(begin), m_end(end) {}
+
+    inline const std::string_view* begin() const { return m_begin; }
+    inline const std::string_view* end() const { return m_end; }
+    inline size_t size() const { return static_cast<size_t>(m_end - m_begin); }
+    inline bool empty() const { return m_begin == m_end; }
+    inline std::string_view operator[](size_t index) const { return m_begin[index]; }
+
+    template<typename T>
+    inline T value(size_t index) const { return parse_value<T>(m_begin[index]); }
+
+private:
+    const std::string_view* m_begin = nullptr;
+    const std::string_view* m_end = nullptr;
+};
+
+// class holding the values of a value_list, either as views into caller memory or as copies in one owned buffer
+class value_list_storage {
+public:
+    value_list_storage() = default;
+    value_list_storage(const value_list_storage& rhs);
+    value_list_storage(value_list_storage&& rhs) noexcept;
+    ~value_list_storage() = default;
+
+    value_list_storage& operator=(const value_list_storage& rhs);
+    value_list_storage& operator=(value_list_storage&& rhs) noexcept;
+
+    void assign(value_list values);
+    void assign_views(value_list values);
+    void clear();
+
+    inline value_list values() const { return value_list(m_views.data(), m_views.data() + m_views.size()); }
+
+private:
+    // points the views into m_storage again, the values are stored back to back
+    void rebase();
+
+    std::string m_storage;
+    std::vector<std::string_view> m_views;
+    bool m_owned = false;
+};
+
+
+// converted value of an argument, a string view either refers to the tokens or to an owned copy
+class argument_cache {
+public:
+    argument_cache() = default;
+    argument_cache(const argument_cache& rhs);
+    argument_cache(argument_cache&& rhs) noexcept;
+    ~argument_cache() = default;
+
+    argument_cache& operator=(const argument_cache& rhs);
+    argument_cache& operator=(argument_cache&& rhs) noexcept;
+
+    void assign(const std::any& value);
+    // same as assign, but a string view is copied and then refers to the copy
+    void assign_copy(const std::any& value);
+    void reset();
+
+    inline const std::any& get() const { return m_value; }
+    inline std::any& get() { return m_value; }
+
+private:
+    std::any m_value;
+    std::string m_storage;
+    bool m_owned = false;
+};
+
 
 class argument {
     friend class parser;
+    friend class prepared_parser;
 
 public:
     argument() = delete;
     ~argument() = default;
 
-    inline keyword get_key() const { return m_key; }
-    inline std::string get_description() const { return m_description; }
+    inline const keyword& get_key() const { return m_key; }
+    inline const std::string& get_description() const { return m_description; }
     inline bool is_parsed() const { return m_parsed; }
 
     bool operator==(const keyword& rhs) const;
@@ -90,44 +485,102 @@ public:
 
     //TODO: as template or std::variant
     virtual void update_value(const std::optional<std::string>& value) {};
+    // same as update_value, but keeps a view into caller memory instead of a copy
+    virtual void update_view(std::string_view /*value*/) {}
+    // same as update_value, but copies the value without a temporary string
+    virtual void update_copy(std::string_view value) { update_value(std::string(value)); }
+
+    // converted value cached while parsing, nullptr if the argument is not typed as T
+    template<typename T>
+    const T* cached_value() const;
+    inline bool is_typed() const { return m_converter != nullptr; }
+
+    // all values of a repeated argument or positional list, empty otherwise
+    inline value_list values() const { return m_list.values(); }
+    inline bool is_repeated() const { return m_repeated; }
 
 protected:
-    virtual void reset() { m_parsed = false; }
+    virtual void reset() { m_parsed = false; m_cache.reset(); m_list.clear(); }
+
+    argument(keyword key, std::string description);
+    argument(const argument& rhs) = default;
+    argument(argument&& rhs) noexcept = default;
 
-    argument(const keyword& key, const std::string& description);
-    argument(const argument& rhs);
+    argument& operator=(const argument& rhs) = default;
+    argument& operator=(argument&& rhs) noexcept = default;
 
     inline void mark_parsed() { m_parsed = true; }
 
+    // convert values once while parsing instead of on each get_value
+    template<typename T>
+    void set_type();
+    // typed as T and written to target by the parser
+    template<typename T>
+    void bind_value(T* target);
+    template<typename T>
+    void bind_list(std::vector<T>* target);
+    bool update_cache(std::string_view value);
+
 private:
+    using converter = bool (*)(std::string_view value, std::any& cache);
+
     keyword m_key;
     std::string m_description;
     bool m_parsed;
+    converter m_converter = nullptr;
+    // builtin_value_type of the converter, 0 if untyped
+    uint8_t m_value_type = 0;
+    // variable of a bound argument, m_binder writes the cached value or the list into it
+    // converted are the converted values of a list, nullptr to take the values as they are
+    using binder = void (*)(const std::any& cache, value_list values, const std::any* converted, void* target);
+    binder m_binder = nullptr;
+    void* m_target = nullptr;
+    // value constraints, see parser::add_range and parser::add_choices
+    long double (*m_number)(const std::any& cache) = nullptr;
+    long double m_min = 0;
+    long double m_max = 0;
+    std::vector<std::string> m_choices;
+    argument_cache m_cache;
+    bool m_repeated = false;
+    value_list_storage m_list;
+    value_completer m_completer;
+    // fallback sources when the argument is not on the command line
+    std::string m_environment;
+    std::string m_config_key;
 };
 
 // ostream operator for argument
-std::ostream& operator<<(std::ostream& os, const argument& command) {
-    os << command.get_key() << "    " << command.get_description();
-    return os;
-}
+std::ostream& operator<<(std::ostream& os, const argument& command);
 
 
 // class representing a subcommand consisting o f keyword, description and sub parser
 // use template here to resolve cyclic dependencies
+// the sub parser lives on the heap, so references to it survive moving the subcommand
+// with a builder the sub parser is created on first use
 template<typename T>
 class subcommand : public argument {
     friend class parser;
+    friend class prepared_parser;
 
 public:
     subcommand() = delete;
-    subcommand(const keyword& key, const std::string& description);
+    subcommand(keyword key, std::string description);
+    subcommand(keyword key, std::string description, std::function<void(T&)> builder, std::function<int(T&)> handler);
     subcommand(const subcommand& rhs);
+    subcommand(subcommand&& rhs) noexcept = default;
     ~subcommand() = default;
 
+    subcommand& operator=(const subcommand& rhs);
+    subcommand& operator=(subcommand&& rhs) noexcept = default;
+
+    // builds a deferred sub parser
     T& get_parser();
+    inline bool is_built() const { return m_parser != nullptr; }
 
 private:
-    T m_parser;
+    std::unique_ptr<T> m_parser;
+    std::function<void(T&)> m_builder;
+    std::function<int(T&)> m_handler;
 };
 
 
@@ -135,10 +588,14 @@ private:
 class flag : public argument {
 public:
     flag() = delete;
-    flag(const keyword& key, const std::string& description);
-    flag(const flag& rhs);
+    flag(keyword key, std::string description);
+    flag(const flag& rhs) = default;
+    flag(flag&& rhs) noexcept = default;
     ~flag() = default;
 
+    flag& operator=(const flag& rhs) = default;
+    flag& operator=(flag&& rhs) noexcept = default;
+
     inline bool is_set() const { return is_parsed(); }
 };
 
@@ -149,19 +606,36 @@ class optional_argument : public argument {
 
 public:
     optional_argument() = delete;
-    optional_argument(const keyword& key, const std::string& description);
-    optional_argument(const optional_argument& rhs);
+    optional_argument(keyword key, std::string description);
+    optional_argument(const optional_argument& rhs) = default;
+    optional_argument(optional_argument&& rhs) noexcept = default;
     ~optional_argument() = default;
 
+    optional_argument& operator=(const optional_argument& rhs) = default;
+    optional_argument& operator=(optional_argument&& rhs) noexcept = default;
+
     template<typename T>
-    inline std::optional<T> value() { return parse_value<T>(m_value); }
+    inline std::optional<T> value() { 
+        if (!m_value.has_value())
+            return std::nullopt;
+        if (auto cached = cached_value<T>())
+            return *cached;
+        return parse_value<T>(m_value.view()); 
+    }
 
 protected:
-    void update_value(const std::optional<std::string>& value) override  { m_value = value; }
-    void reset() override { argument::reset(); m_value = std::nullopt; }
+    void update_value(const std::optional<std::string>& value) override { 
+        if (value.has_value())
+            m_value.assign(value.value());
+        else
+            m_value.clear();
+    }
+    void update_view(std::string_view value) override { m_value.assign_view(value); }
+    void update_copy(std::string_view value) override { m_value.assign(value); }
+    void reset() override { argument::reset(); m_value.clear(); }
 
 private:
-    std::optional<std::string> m_value;
+    argument_value m_value;
 };
 
 
@@ -172,22 +646,32 @@ class mandatory_argument : public argument {
 
 public:
     mandatory_argument() = delete;
-    mandatory_argument(const keyword& key, const std::string& description);
-    mandatory_argument(const mandatory_argument& rhs);
+    mandatory_argument(keyword key, std::string description);
+    mandatory_argument(const mandatory_argument& rhs) = default;
+    mandatory_argument(mandatory_argument&& rhs) noexcept = default;
     ~mandatory_argument() = default;
 
+    mandatory_argument& operator=(const mandatory_argument& rhs) = default;
+    mandatory_argument& operator=(mandatory_argument&& rhs) noexcept = default;
+
     template<typename T>
-    inline T value() { return parse_value<T>(m_value); }
+    inline T value() { 
+        if (auto cached = cached_value<T>())
+            return *cached;
+        return parse_value<T>(m_value.view()); 
+    }
 
 protected:
-    void update_value(const std::optional<std::string>& value) override { m_value = value.value(); }
+    void update_value(const std::optional<std::string>& value) override { m_value.assign(value.value()); }
+    void update_view(std::string_view value) override { m_value.assign_view(value); }
+    void update_copy(std::string_view value) override { m_value.assign(value); }
     void reset() override { 
         argument::reset(); 
-        m_value = std::string();
+        m_value.clear();
     }
 
 private:
-    std::string m_value;
+    argument_value m_value;
 };
 
 
@@ -198,624 +682,2192 @@ class positional_argument : public argument {
 
 public:
     positional_argument() = delete;
-    positional_argument(const std::string& name, const std::string& description);
-    positional_argument(const positional_argument& rhs);
+    positional_argument(std::string name, std::string description);
+    positional_argument(const positional_argument& rhs) = default;
+    positional_argument(positional_argument&& rhs) noexcept = default;
     ~positional_argument() = default;
 
+    positional_argument& operator=(const positional_argument& rhs) = default;
+    positional_argument& operator=(positional_argument&& rhs) noexcept = default;
+
     template<typename T>
-    inline T value() { return parse_value<T>(m_value); }
+    inline T value() { 
+        if (auto cached = cached_value<T>())
+            return *cached;
+        return parse_value<T>(m_value.view()); 
+    }
 
 protected:
-    void update_value(const std::optional<std::string>& value) override  { m_value = value.value(); }
-    void reset() override { argument::reset(); m_value = std::string(); }
+    void update_value(const std::optional<std::string>& value) override  { m_value.assign(value.value()); }
+    void update_view(std::string_view value) override { m_value.assign_view(value); }
+    void update_copy(std::string_view value) override { m_value.assign(value); }
+    void reset() override { argument::reset(); m_value.clear(); }
 
 private:
-    std::string m_value;
+    argument_value m_value;
 };
 
 
-// main argument parser class
-class parser {
-public:
-    parser() = default;
-    parser(const parser& rhs) = default;
-    ~parser() = default;
-
-    void usage(const std::string& app_name);
-    void parse(int argc, char **args);
-    
-    inline size_t subcommands() { return m_subcommands.size(); }
-    inline size_t flags() { return m_flags.size(); }
-    inline size_t mandatories() { return m_mandatories.size(); }
-    inline size_t optionals() { return m_optionals.size(); }
-    inline size_t positionals() { return m_positionals.size(); }
-
-    parser& get_subcommand_parser(const keyword& key);
+// bytes holding the value of a floating point type, x87 extended precision pads its 10 bytes
+template<typename T>
+constexpr size_t schema_float_bytes() { return std::numeric_limits<T>::digits == 64 && sizeof(T) > 10 ? 10 : sizeof(T); }
 
-    parser& add_subcommand(const std::string& key, const std::string& description);
-    parser& add_flag(const keyword& key, const std::string& description);
-    parser& add_mandatory_argument(const keyword& key, const std::string& description);
-    parser& add_optional_argument(const keyword& key, const std::string& description);
-    parser& add_argument(const keyword& key, const std::string& description, bool optional = true);
-    parser& add_positional(const std::string& name, const std::string& description);
+// appends trivially copyable values and tables to a flat schema image in native byte order
+// structs with padding provide fields and are written member by member, so equal schemas give equal images
+class schema_writer {
+public:
+    explicit schema_writer(std::string& image) : m_image(image) {}
 
     template<typename T>
-    std::optional<T> get_value(const keyword& key);
-    bool get_flag(const keyword& key);
+    void write(const T& value);
+    template<typename T, typename Allocator>
+    void write(const std::vector<T, Allocator>& values);
+    template<typename T, size_t N>
+    void write(const std::array<T, N>& values);
+    template<typename Traits, typename Allocator>
+    void write(const std::basic_string<char, Traits, Allocator>& value);
 
-protected:
-    void parse_vector(std::vector<std::string>& args);
-    
 private:
-    enum argument_value_type {
-        none,
-        one_string,
-        equal_sign,
-        whitespace,
-        colon,
-    };
+    std::string& m_image;
+};
 
-    auto get_subcommand(const keyword& key);
-    bool parse_subcommand(std::vector<std::string>& args);
-    void parse_flags(std::vector<std::string>& args);
-    void parse_options(std::vector<std::string>& args);
-    void parse_positionals(std::vector<std::string>& args);
 
-    auto parse_argument_value(const std::string& arg);
-    template<typename T>
-    auto parse_argument_value(const std::string& arg, T begin, T end);
+// reads what schema_writer wrote, running past the end of the image fails with err_invalid_schema_image
+class schema_reader {
+public:
+    explicit schema_reader(std::string_view image) : m_image(image) {}
 
     template<typename T>
-    auto find_option(const keyword& key, T begin, T end);
+    void read(T& value);
+    // tables are resized once and copied, so each takes a single allocation
+    template<typename T, typename Allocator>
+    void read(std::vector<T, Allocator>& values);
+    template<typename T, size_t N>
+    void read(std::array<T, N>& values);
+    template<typename Traits, typename Allocator>
+    void read(std::basic_string<char, Traits, Allocator>& value);
 
-    void check_mandatory();
-    void check_positional();
-    void check_keyword(const keyword& key);
-    auto check_value_type(const std::string& key, const std::string& arg);
+    inline bool at_end() const { return m_image.empty(); }
 
-    std::vector<keyword> m_keywords;
-    std::vector<subcommand<parser>> m_subcommands;
-    std::vector<flag> m_flags;
-    std::vector<mandatory_argument> m_mandatories;
-    std::vector<optional_argument> m_optionals;
-    std::vector<positional_argument> m_positionals;
+private:
+    const char* take(size_t length);
+    // bytes of one T in the image
+    template<typename T>
+    static size_t record_bytes();
+
+    std::string_view m_image;
 };
 
 
+// flat open addressing hash table mapping keys and abbreviations to arguments
+class keyword_index {
+public:
+    // kind of the indexed argument, usable as bit mask for lookups
+    enum kind : uint8_t {
+        none = 0,
+        subcommand_kind = 1,
+        flag_kind = 2,
+        mandatory_kind = 4,
+        optional_kind = 8,
+        positional_kind = 16,
+        any_kind = 31,
+    };
 
+    struct entry {
+        kind type;
+        uint32_t index;
 
-// ====================================================
-// IMPLEMENTATIONS
-// ====================================================
+        // members in schema image order, structs with padding are saved member by member
+        template<typename Self, typename Visitor>
+        static void fields(Self& self, Visitor&& visit) { visit(self.type); visit(self.index); }
+    };
 
-template<>
-std::string parse_value(const std::string& value)
-{
-    return value;
-}
+    keyword_index() = default;
+    explicit keyword_index(std::pmr::memory_resource* resource);
+    keyword_index(const keyword_index& rhs) = default;
+    // copy allocating from resource
+    keyword_index(const keyword_index& rhs, std::pmr::memory_resource* resource);
+    ~keyword_index() = default;
 
+    keyword_index& operator=(const keyword_index& rhs) = default;
 
-template<>
-std::optional<std::string> parse_value(const std::optional<std::string>& value)
-{
-   return value;
-}
+    // returns false if the name is already indexed
+    bool insert(std::string_view name, kind type, uint32_t index);
+    // returns false if key or abbreviation is already indexed
+    bool insert_keyword(const keyword& key, kind type, uint32_t index);
 
-template<typename T>
-T parse_value(const std::string& value)
-{
-    std::istringstream iss(value);
-    T casted;
-    iss >> casted;
-    return casted;
-}
+    const entry* find(std::string_view name, uint8_t kinds = any_kind) const;
+    const entry* find_keyword(const keyword& key, uint8_t kinds = any_kind) const;
+    bool contains(const keyword& key) const;
 
+    inline size_t size() const { return m_size; }
+    void clear();
 
-template<typename T>
-std::optional<T> parse_value(const std::optional<std::string>& value)
-{
-    if (!value.has_value())
-        return std::nullopt;
-    return parse_value<T>(value.value());
-}
+    void save(schema_writer& writer) const;
+    void load(schema_reader& reader);
 
+    // true if predicate holds for every indexed entry
+    template<typename Predicate>
+    bool all_of(Predicate predicate) const;
+    // size of a table slot, part of the schema image layout
+    static constexpr size_t slot_size() { return sizeof(slot); }
 
-//argcpp17_exception implementations
-argcpp17_exception::argcpp17_exception(argcpp17_error error) 
-    : m_error(error) 
-{};
-
-const char* argcpp17_exception::what() const noexcept
-{
-    switch (m_error) {
-        case err_duplicate_keyword:
-            return "keyword already used";
-        case err_unknown_arguments:
-            return "found unknown arguments";
-        case err_missing_positionals:
-            return "missing positional argumenzs";
-        case err_subcommand_not_found:
-            return "subcommand not found";
-        case err_missing_mandatory:
-            return "missing mandatory argument";
-        case err_missing_positional:
-            return "missing positional argument";
-        default:
-            return "unknown error in argcpp17";
-    }
-}
+private:
+    struct slot {
+        uint64_t hash;
+        uint32_t offset;
+        uint32_t length;
+        entry value;
+
+        template<typename Self, typename Visitor>
+        static void fields(Self& self, Visitor&& visit) { visit(self.hash); visit(self.offset); visit(self.length); visit(self.value); }
+    };
 
+    static uint64_t hash(std::string_view name);
+    inline std::string_view name(const slot& s) const { return std::string_view(m_names.data() + s.offset, s.length); }
+    const slot* find_slot(std::string_view name, uint64_t hash) const;
+    void grow();
 
-//keyword implementations
-keyword::keyword(const std::string& key, const std::optional<std::string>& abbreviation) 
-    : m_key(key)
-    , m_abbreviation(abbreviation)
-{}
+    std::pmr::vector<slot> m_slots;
+    std::pmr::string m_names;
+    size_t m_size = 0;
+};
 
-keyword::keyword(const keyword& rhs)
-    : m_key(rhs.m_key)
-    , m_abbreviation(rhs.m_abbreviation)
-{}
 
-bool keyword::operator==(const keyword& rhs) const
-{
-    return m_key == rhs.m_key || 
-           m_key == rhs.m_abbreviation ||
-           m_abbreviation == rhs.m_key ||
-           (m_abbreviation.has_value() && m_abbreviation == rhs.m_abbreviation);
-}
+// prefix trie over normalized option names ("--key", "-abbreviation")
+// matching a token is one walk over its characters with longest match semantics
+class option_trie {
+public:
+    explicit option_trie(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    option_trie(const option_trie& rhs) = default;
+    // copy allocating from resource
+    option_trie(const option_trie& rhs, std::pmr::memory_resource* resource);
+    ~option_trie() = default;
 
-bool keyword::operator==(const std::string& rhs) const
-{
-    return m_key == rhs || 
-           m_abbreviation == rhs;
-}
+    option_trie& operator=(const option_trie& rhs) = default;
 
+    // returns false if the name is already inserted
+    bool insert(std::string_view name, keyword_index::entry value);
+    bool contains(std::string_view name) const;
 
+    // longest inserted name which is a prefix of arg, length receives the matched length
+    const keyword_index::entry* longest_prefix(std::string_view arg, size_t& length) const;
 
-//argument implementations
-argument::argument(const keyword& key, const std::string& description)
-    : m_key(key)
-    , m_description(description)
-    , m_parsed(false)
-{};
-
-argument::argument(const argument& rhs) 
-    : m_key(rhs.m_key)
-    , m_description(rhs.m_description)
-    , m_parsed(rhs.m_parsed)
-{}
+    // inserted names which are a proper prefix of another inserted name
+    std::vector<std::string> ambiguous_prefixes() const;
 
-bool argument::operator==(const keyword& rhs) const
-{
-    return m_key == rhs;
-}
+    inline size_t size() const { return m_size; }
 
-bool argument::operator==(const std::string& rhs) const
-{
-    return m_key == rhs;
-}
+    void save(schema_writer& writer) const;
+    void load(schema_reader& reader);
 
+    // true if predicate holds for the entry of every inserted name
+    template<typename Predicate>
+    bool all_of(Predicate predicate) const;
+    // size of a trie node, part of the schema image layout
+    static constexpr size_t node_size() { return sizeof(node); }
 
-//subcommand implementations
-template<>
-subcommand<parser>::subcommand(const keyword& key, const std::string& description)
-    : argument(key, description)
-{};
+private:
+    static constexpr uint32_t npos = UINT32_MAX;
+
+    struct node {
+        uint32_t child;
+        uint32_t sibling;
+        char c;
+        bool terminal;
+        keyword_index::entry value;
+
+        template<typename Self, typename Visitor>
+        static void fields(Self& self, Visitor&& visit) {
+            visit(self.child); visit(self.sibling); visit(self.c); visit(self.terminal); visit(self.value);
+        }
+    };
 
-template<>
-subcommand<parser>::subcommand(const subcommand<parser>& rhs) 
-    : argument(rhs)
-    , m_parser(rhs.m_parser)
-{}
+    uint32_t find_child(uint32_t parent, char c) const;
 
-template<>
-parser& subcommand<parser>::get_parser() 
-{ 
-    return m_parser; 
-}
+    std::pmr::vector<node> m_nodes;
+    size_t m_size = 0;
+};
 
 
-//flag implementations
-flag::flag(const keyword& key, const std::string& description)
-    : argument(key, description)
-{};
+#if defined(ARGCPP17_ENABLE_STATS)
+// memory resource counting the allocations of the current thread
+class counting_resource : public std::pmr::memory_resource {
+public:
+    struct counters {
+        size_t allocations = 0;
+        size_t bytes = 0;
+    };
 
-flag::flag(const flag& rhs) 
-    : argument(rhs)
-{}
+    explicit counting_resource(std::pmr::memory_resource* upstream);
 
-keyword verify_argument_key(const keyword& key)
-{
-    keyword updated_key = key;
-    if (updated_key.get_key().substr(2) != "--")
-        updated_key = keyword("--" + updated_key.get_key(), updated_key.get_abbreviation());
-    else if (updated_key.get_key().substr(1) != "-")
-        updated_key = keyword("-" + updated_key.get_key(), updated_key.get_abbreviation());
-    if (updated_key.get_abbreviation().has_value() && (updated_key.get_abbreviation().value().substr(1) != "-"))
-        updated_key = keyword(updated_key.get_key(), "-" + updated_key.get_abbreviation().value());
-    return updated_key;    
-}
+    static counters& thread_counters();
+    // counts a container of the std allocator that grew from capacity before to after
+    static void record_growth(size_t before, size_t after, size_t element_size);
 
-//optional_argument implementations
-optional_argument::optional_argument(const keyword& key, const std::string& description)
-    : argument(key, description)
-{
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    std::pmr::memory_resource* m_upstream;
 };
 
-optional_argument::optional_argument(const optional_argument& rhs) 
-    : argument(rhs)
-    , m_value(rhs.m_value)
-{}
+// default resource of parse results and of schemas prepared by parser
+counting_resource* statistics_resource();
 
 
-//mandatory_argument implementations
-mandatory_argument::mandatory_argument(const keyword& key, const std::string& description)
-    : argument(key, description)
-{
+// adds the time from construction until stop to one phase of the statistics
+class phase_timer {
+public:
+    explicit phase_timer(parse_statistics* statistics);
+
+    void stop(std::chrono::nanoseconds parse_statistics::* phase);
+
+private:
+    parse_statistics* m_statistics;
+    std::chrono::steady_clock::time_point m_start;
 };
+#endif
 
-mandatory_argument::mandatory_argument(const mandatory_argument& rhs) 
-    : argument(rhs)
-    , m_value(rhs.m_value)
-{}
 
+// memory mapped response file
+// the mapping is private and writable, so tokens are unescaped in place without copying the file
+class response_file {
+public:
+    response_file() = default;
+    response_file(const response_file& rhs) = delete;
+    ~response_file();
 
-//positional_argument implementations
-positional_argument::positional_argument(const std::string& name, const std::string& description)
-    : argument(name, description)
-{};
+    response_file& operator=(const response_file& rhs) = delete;
 
-positional_argument::positional_argument(const positional_argument& rhs) 
-    : argument(rhs)
-    , m_value(rhs.m_value)
-{}
+    bool open(const std::string& path);
+    void close();
 
+    inline char* data() { return m_data; }
+    inline size_t size() const { return m_size; }
 
-//parser implementations
-void parser::usage(const std::string& app_name)
-{
-    std::cout << app_name << " [sub-command] <mandatory_options> [options/flags]";
-    for (auto positional : m_positionals)
-        std::cout << " " << positional.m_key.get_key();
-    std::cout << std::endl;
-    std::cout << std::endl;
-
-    if (m_subcommands.size()) {
-        std::cout << "sub-commands:" << std::endl;
-        for (auto i : m_subcommands) {
-            auto key = i.get_key();
-            auto desc = i.get_description();
-            auto full_key = key.get_key();
-            auto abbr_key = key.get_abbreviation();
-            std::cout << "  " << full_key;
-            if (abbr_key.has_value())
-                std::cout << ", " << abbr_key.value();
-            std::cout << ": " << desc;
-        }
-    }
+private:
+    char* m_data = nullptr;
+    size_t m_size = 0;
+    bool m_mapped = false;
+    // file contents on platforms without mmap
+    std::vector<char> m_buffer;
+};
 
-    if (m_mandatories.size()) {
-        std::cout << "mandatory options:" << std::endl;
-        for (auto i : m_mandatories) {
-            auto key = i.get_key();
-            auto desc = i.get_description();
-            auto full_key = key.get_key();
-            auto abbr_key = key.get_abbreviation();
-            std::cout << "  [-" << full_key;
-            if (abbr_key.has_value())
-                std::cout << ", -" << abbr_key.value();
-            std::cout << "]<value>: " << desc;
-        }
-    }
 
-    if (m_optionals.size()) {
-        std::cout << "options:" << std::endl;
-        for (auto i : m_mandatories) {
-            auto key = i.get_key();
-            auto desc = i.get_description();
-            auto full_key = key.get_key();
-            auto abbr_key = key.get_abbreviation();
-            std::cout << "  [-" << full_key;
-            if (abbr_key.has_value())
-                std::cout << ", -" << abbr_key.value();
-            std::cout << "]<value>: " << desc;
-        }
+// expands @file tokens of an argument range lazily while it is iterated
+// tokens in response files are separated by whitespace, characters in single quotes are taken literally,
+// double quotes group whitespace and a backslash escapes the next character outside of single quotes
+// quoted tokens are never expanded, so '@file' passes a literal @file
+// tokens are views into argv or into the response files, which are kept alive by files
+template<typename It>
+class response_expander {
+public:
+    static constexpr size_t default_depth = 8;
+
+    // single pass iterator over the expanded tokens
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::string_view*;
+        using reference = const std::string_view&;
+
+        iterator(response_expander* owner = nullptr) : m_owner(owner) {}
+
+        inline reference operator*() const { return m_owner->m_current; }
+        inline pointer operator->() const { return &m_owner->m_current; }
+        inline iterator& operator++() { m_owner->next(); return *this; }
+        inline bool operator==(const iterator& rhs) const { return done() == rhs.done(); }
+        inline bool operator!=(const iterator& rhs) const { return done() != rhs.done(); }
+
+    private:
+        inline bool done() const { return !m_owner || m_owner->m_done; }
+
+        response_expander* m_owner;
+    };
+
+    response_expander(It begin, It end, std::vector<std::shared_ptr<response_file>>& files, size_t max_depth = default_depth);
+
+    iterator begin();
+    inline iterator end() { return iterator(); }
+
+    // failure while expanding, iteration ends at the failing token
+    // - err_response_file: response file could not be read
+    // - err_response_file_depth: response files nested deeper than max_depth
+    inline const parse_status& status() const { return m_status; }
+
+private:
+    struct frame {
+        response_file* file;
+        size_t position;
+    };
+
+    void next();
+    bool next_token(frame& current, std::string_view& token, bool& quoted);
+    bool expand(std::string_view token);
+
+    It m_it;
+    It m_end;
+    std::vector<std::shared_ptr<response_file>>& m_files;
+    std::vector<frame> m_stack;
+    size_t m_max_depth;
+    size_t m_index = 0;
+    std::string_view m_current;
+    parse_status m_status;
+    bool m_started = false;
+    bool m_done = false;
+};
+
+
+class parser;
+class prepared_parser;
+
+
+// range of tokens, the tokens left unparsed by a lazy parse or a command line of a batch
+template<typename It>
+struct token_range {
+    It first;
+    It last;
+
+    inline It begin() const { return first; }
+    inline It end() const { return last; }
+    inline bool empty() const { return first == last; }
+};
+
+
+// UTF-8 tokens transcoded from a wide argv or a Windows command line into one buffer
+// wchar_t is read as UTF-16 or UTF-32 depending on its size, invalid code units become U+FFFD
+// the buffer and the token views are reused by the next assign, so views are valid until then
+class wide_command_line {
+public:
+    wide_command_line() = default;
+
+    // argv of wmain, the program name is skipped
+    void assign(int argc, wchar_t **args);
+    // command line split with the rules of CommandLineToArgvW, the program name is skipped
+    void assign(std::wstring_view command_line);
+
+    inline const std::string_view* begin() const { return m_tokens.data(); }
+    inline const std::string_view* end() const { return m_tokens.data() + m_tokens.size(); }
+    inline size_t size() const { return m_tokens.size(); }
+
+private:
+    // transcodes the code point starting at text[i] and advances i past it
+    void append_utf8(std::wstring_view text, size_t& i);
+    void begin_token();
+    void end_token();
+
+    std::string m_buffer;
+    size_t m_token_start = 0;
+    std::vector<std::string_view> m_tokens;
+};
+
+
+// typed accessor of an option or positional, resolved once by parser::get_handle
+// reading it is an indexed load of the value converted while parsing, without keyword lookup or conversion
+// it refers to the parser it came from and stays valid while arguments are added, but not across copies
+template<typename T>
+class option_handle {
+    friend class parser;
+    friend class parse_result;
+
+public:
+    option_handle() = default;
+
+    // value of the last parse, nullptr if the argument was not given
+    const T* get() const;
+    inline const T& operator*() const { return *get(); }
+    inline const T* operator->() const { return get(); }
+    inline explicit operator bool() const { return get() != nullptr; }
+
+private:
+    option_handle(const parser* owner, keyword_index::entry entry) : m_parser(owner), m_entry(entry) {}
+
+    const parser* m_parser = nullptr;
+    keyword_index::entry m_entry = { keyword_index::none, 0 };
+};
+
+
+// accessor of a flag, resolved once by parser::get_flag_handle
+class flag_handle {
+    friend class parser;
+    friend class parse_result;
+
+public:
+    flag_handle() = default;
+
+    bool is_set() const;
+    inline explicit operator bool() const { return is_set(); }
+
+private:
+    flag_handle(const parser* owner, uint32_t index) : m_parser(owner), m_index(index) {}
+
+    const parser* m_parser = nullptr;
+    uint32_t m_index = 0;
+};
+
+
+// result of parsing with a prepared_parser
+// results can be reused, parsing again keeps all buffers and allocates nothing
+// values are views into the parsed tokens, which must outlive the result
+// all buffers, including subcommand results, are allocated from the memory resource of the result
+class parse_result {
+    friend class prepared_parser;
+    friend class parser;
+
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+    static constexpr size_t npos = SIZE_MAX;
+
+#if defined(ARGCPP17_ENABLE_STATS)
+    parse_result();
+#else
+    parse_result() = default;
+#endif
+    explicit parse_result(const allocator_type& allocator);
+    parse_result(const parse_result& rhs);
+    parse_result(const parse_result& rhs, const allocator_type& allocator);
+    ~parse_result() = default;
+
+    parse_result& operator=(const parse_result& rhs);
+
+    inline bool ok() const { return m_error == err_none; }
+    // error code, only valid if not ok
+    inline argcpp17_exception::argcpp17_error error() const { return m_error_code; }
+    // index of the offending token, or number of tokens if something is missing
+    inline size_t error_index() const { return m_error_index; }
+    inline parse_status status() const { return parse_status{ ok(), m_error_code, m_error_index }; }
+
+    bool get_flag(const keyword& key) const;
+    template<typename T>
+    std::optional<T> get_value(const keyword& key) const;
+
+    // all values of a repeated argument or positional list
+    value_list get_values(const keyword& key) const;
+
+    // values through handles of the parser this schema was prepared from
+    template<typename T>
+    const T* get(const option_handle<T>& handle) const;
+    bool get(const flag_handle& handle) const;
+
+    // parse result of the selected subcommand, nullptr if key was not selected
+    const parse_result* get_subcommand(const keyword& key) const;
+    // index of the selected subcommand in order of registration, or npos
+    inline size_t subcommand() const { return m_subcommand; }
+    inline const parse_result* subcommand_result() const { return m_subcommand == npos ? nullptr : &m_subcommand_result.front(); }
+
+    // forget all values but keep buffers
+    void clear();
+
+    inline allocator_type get_allocator() const { return m_parsed.get_allocator(); }
+
+#if defined(ARGCPP17_ENABLE_STATS)
+    // statistics recorded by following parses, nullptr stops recording
+    inline void record_statistics(parse_statistics* statistics) { m_statistics = statistics; }
+#endif
+
+private:
+    enum state {
+        err_none,
+        err_set,
+    };
+
+    void prepare(const prepared_parser& schema);
+    bool fail(argcpp17_exception::argcpp17_error error, size_t index);
+    parse_result& subcommand_result(size_t index);
+    void collect_lists();
+    value_list slot_values(size_t slot) const;
+    // converted values of slot_values, nullptr if there are none
+    const std::any* slot_cache(size_t slot) const;
+    size_t find_value_slot(const keyword& key) const;
+
+    const prepared_parser* m_schema = nullptr;
+    std::pmr::vector<uint8_t> m_parsed;
+    std::pmr::vector<std::string_view> m_values;
+    // converted values larger than the small buffer of std::any are still allocated on the heap
+    std::pmr::vector<std::any> m_cache;
+    // values of repeated slots in parse order, sorted by slot into m_lists after parsing
+    // their converted values are sorted along into m_list_cache, m_cache keeps the last one of each slot
+    std::pmr::vector<std::pair<size_t, std::string_view>> m_repeated;
+    std::pmr::vector<std::any> m_repeated_cache;
+    std::pmr::vector<std::string_view> m_lists;
+    std::pmr::vector<std::any> m_list_cache;
+    std::pmr::vector<size_t> m_list_offsets;
+    size_t m_subcommand = npos;
+    // empty or the result of the last selected subcommand, allocated from the same resource
+    std::pmr::vector<parse_result> m_subcommand_result;
+    state m_error = err_none;
+    argcpp17_exception::argcpp17_error m_error_code = argcpp17_exception::err_unknown;
+    size_t m_error_index = 0;
+#if defined(ARGCPP17_ENABLE_STATS)
+    parse_statistics* m_statistics = nullptr;
+#endif
+};
+
+
+// results of a batch parse as parallel arrays, entry i belongs to command line i
+// errors and error_indices are only valid where ok is 0
+// parsing the next batch into the same instance reuses the buffers of the results
+struct batch_result {
+    std::vector<parse_result> results;
+    std::vector<uint8_t> ok;
+    std::vector<argcpp17_exception::argcpp17_error> errors;
+    std::vector<size_t> error_indices;
+
+    inline size_t size() const { return results.size(); }
+    size_t failures() const;
+    void resize(size_t count);
+};
+
+
+// frozen schema compiled from a parser
+// parsing does not modify the schema, all state is written into a parse_result,
+// so a single instance can be shared read-only across threads without locking
+class prepared_parser {
+    friend class parse_result;
+    friend class parser;
+
+public:
+    prepared_parser() = default;
+    // all schema tables are allocated from resource
+    explicit prepared_parser(const parser& source, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    // placeholder of a subcommand that is not built yet, parsing it fails with err_subcommand_deferred
+    explicit prepared_parser(std::pmr::memory_resource* resource);
+    ~prepared_parser() = default;
+
+    // parse without throwing, argv must outlive the result
+    bool parse(int argc, char **args, parse_result& result) const;
+    template<typename It>
+    bool parse(It begin, It end, parse_result& result) const;
+
+    // lazy parse: stops at "--" or at the first positional token without a declared positional,
+    // those tokens are returned in rest and are neither converted nor validated
+    // a positional list is not filled, its tokens are part of rest
+    bool parse_lazy(int argc, char **args, parse_result& result, token_range<char**>& rest) const;
+    template<typename It>
+    bool parse_lazy(It begin, It end, parse_result& result, token_range<It>& rest) const;
+
+    // parse every command line in [begin, end) into batch, chunks of lines are spread over threads
+    // a command line is a range of tokens without the program name, e.g. std::vector<std::string> or token_range<char**>
+    // threads 0 uses one thread per core, the command lines must outlive batch
+    // threads are started for each call, It must be a random access iterator,
+    // an exception thrown while parsing a line is rethrown after all threads finished
+    template<typename It>
+    void parse_batch(It begin, It end, batch_result& batch, unsigned threads = 0) const;
+
+    // completion candidates for word, the partial token following the complete tokens [begin, end)
+    // subcommands, flags and option names come from a sorted table, values from the completers
+    template<typename It>
+    void complete(It begin, It end, std::string_view word, std::vector<std::string>& candidates) const;
+
+    // flat image of the schema tables and descriptions, e.g. written at build time and loaded on startup
+    // completers and environment or config fallbacks are not saved, deferred subcommands stay deferred
+    std::string save() const;
+    // loads an image written by save with the same library version on the same platform
+    // the image may be mapped memory or embedded data, keywords are not validated again
+    // every table takes a single allocation from resource, typed arguments of types outside builtin_value_types load untyped
+    static prepared_parser load(std::string_view image, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    // description of a subcommand, flag, option or positional, empty if key is unknown
+    std::string_view description(const keyword& key) const;
+
+    inline size_t subcommands() const { return m_subcommands.size(); }
+    inline size_t flags() const { return m_flags; }
+    inline size_t mandatories() const { return m_mandatories; }
+    inline size_t optionals() const { return m_optionals; }
+    inline size_t positionals() const { return m_positionals; }
+
+private:
+    using converter = bool (*)(std::string_view value, std::any& cache);
+
+    enum argument_value_type {
+        none,
+        one_string,
+        equal_sign,
+        whitespace,
+        colon,
+    };
+
+    // slots are ordered flags, mandatories, optionals, positionals
+    inline size_t slots() const { return m_flags + m_mandatories + m_optionals + m_positionals; }
+    inline size_t mandatory_slot(size_t index) const { return m_flags + index; }
+    inline size_t optional_slot(size_t index) const { return m_flags + m_mandatories + index; }
+    inline size_t positional_slot(size_t index) const { return m_flags + m_mandatories + m_optionals + index; }
+    size_t slot(const keyword_index::entry& entry) const;
+
+    template<typename It>
+    bool parse_tokens(It begin, It end, size_t offset, parse_result& result, It* rest = nullptr) const;
+    bool update_value(size_t slot, std::string_view value, parse_result& result) const;
+    std::pair<argument_value_type, std::string_view> check_value_type(std::string_view key, std::string_view arg) const;
+    bool is_current(const parser& source) const;
+    inline bool is_deferred() const { return m_deferred; }
+    static constexpr uint32_t schema_image_magic = 0x37316761;
+    static constexpr uint32_t schema_image_version = 3;
+    static uint64_t schema_image_layout();
+    void save_tables(schema_writer& writer) const;
+    void load_tables(schema_reader& reader);
+    // loaded tables only index into each other, checked once so parsing needs no bounds checks
+    bool valid_entry(const keyword_index::entry& entry, uint8_t kinds) const;
+    bool valid_tables() const;
+    void add_flag_filter(std::string_view name);
+    void add_short_option(const std::optional<std::string>& abbreviation, keyword_index::entry entry);
+    bool is_cluster(std::string_view arg) const;
+    // true if an argument conflicting with slot was given, only the conflicts of slot are visited
+    inline bool conflicts(size_t slot, const parse_result& result) const
+    {
+        if (m_conflict_offsets.empty())
+            return false;
+        for (auto i = m_conflict_offsets[slot]; i < m_conflict_offsets[slot + 1]; i++)
+            if (result.m_parsed[m_conflicts[i]])
+                return true;
+        return false;
     }
+    bool check_value(size_t slot, std::string_view value, const std::any& cache) const;
+    // calls body for consecutive chunks [first, last) of [0, count) on up to threads new threads, the caller included
+    // rethrows the first exception of body once all threads are joined
+    static void run_parallel(size_t count, unsigned threads, const std::function<void(size_t, size_t)>& body);
+    static inline bool may_be_option(std::string_view arg) { return !arg.empty() && arg.front() == '-'; }
+    inline bool may_be_flag(std::string_view arg) const
+    {
+        auto head = static_cast<unsigned char>(arg.empty() ? 0 : arg.front());
+        return (m_flag_lengths >> std::min<size_t>(arg.length(), 63) & 1) && (m_flag_heads[head >> 6] >> (head & 63) & 1);
+    }
+    void add_candidate(std::string_view name, keyword_index::kind type);
+    void complete_word(std::string_view word, bool first, size_t positional, std::vector<std::string>& candidates) const;
+    void complete_value(size_t slot, std::string_view lead, std::string_view prefix, std::vector<std::string>& candidates) const;
+
+    // value from the environment or config for a slot not given on the command line
+    struct fallback {
+        uint32_t slot;
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    // completion candidate, name is stored in m_candidate_names
+    struct candidate {
+        uint32_t offset;
+        uint32_t length;
+        keyword_index::kind type;
+
+        template<typename Self, typename Visitor>
+        static void fields(Self& self, Visitor&& visit) { visit(self.offset); visit(self.length); visit(self.type); }
+    };
+    inline std::string_view candidate_name(const candidate& c) const { return std::string_view(m_candidate_names.data() + c.offset, c.length); }
+
+    keyword_index m_index;
+    keyword_index m_positional_index;
+    option_trie m_option_trie;
+    std::pmr::vector<prepared_parser> m_subcommands;
+    std::pmr::vector<converter> m_converters;
+    std::pmr::vector<uint8_t> m_value_types;
+    std::pmr::vector<uint8_t> m_repeated;
+    std::pmr::vector<value_completer> m_completers;
+    // sorted by name for prefix lookups
+    std::pmr::vector<candidate> m_candidates;
+    std::pmr::string m_candidate_names;
+    // resolved when preparing, environment before config
+    std::pmr::vector<fallback> m_fallbacks;
+    std::pmr::string m_fallback_values;
+    // descriptions of the slots followed by the subcommands, m_description_offsets has one more entry
+    std::pmr::string m_descriptions;
+    std::pmr::vector<uint32_t> m_description_offsets;
+
+    // constraints, each table is empty if the parser has none of its kind
+    struct requirement {
+        uint32_t slot;
+        uint32_t required;
+    };
+    struct value_range {
+        long double min;
+        long double max;
+
+        template<typename Self, typename Visitor>
+        static void fields(Self& self, Visitor&& visit) { visit(self.min); visit(self.max); }
+    };
+    struct choice {
+        uint32_t offset;
+        uint32_t length;
+    };
+    // conflicting slots of slot i are m_conflicts[m_conflict_offsets[i], m_conflict_offsets[i + 1])
+    std::pmr::vector<uint32_t> m_conflict_offsets;
+    std::pmr::vector<uint32_t> m_conflicts;
+    std::pmr::vector<requirement> m_requirements;
+    // number getter of the converted value per slot, nullptr without range
+    std::pmr::vector<long double (*)(const std::any&)> m_numbers;
+    std::pmr::vector<value_range> m_ranges;
+    // choices of slot i are m_choices[m_choice_offsets[i], m_choice_offsets[i + 1]), names in m_choice_names
+    std::pmr::vector<uint32_t> m_choice_offsets;
+    std::pmr::vector<choice> m_choices;
+    std::pmr::string m_choice_names;
+    // token filters: options always start with '-', flags need a known length and first character
+    // so most positional tokens are classified without a trie walk or hash
+    uint64_t m_flag_lengths = 0;
+    std::array<uint64_t, 4> m_flag_heads = {};
+    // single character abbreviations of flags and options by character, for clusters like -xvf
+    std::array<keyword_index::entry, 256> m_short_options = {};
+    // last positional takes all remaining positional tokens
+    bool m_positional_list = false;
+    bool m_deferred = false;
+    size_t m_flags = 0;
+    size_t m_mandatories = 0;
+    size_t m_optionals = 0;
+    size_t m_positionals = 0;
+
+    // parser this schema was prepared from, only used to detect changes
+    const parser* m_source = nullptr;
+    uint64_t m_generation = 0;
+};
+
+
+// main argument parser class
+class parser {
+    friend class prepared_parser;
+    template<typename T>
+    friend class option_handle;
+    friend class flag_handle;
+
+public:
+    // storage of parsed values
+    // - copy_values: values are copied into the argument objects
+    // - view_values: values are views into argv, which must outlive the parser
+    enum storage_mode {
+        copy_values,
+        view_values,
+    };
+
+    // fills the schema of a deferred subcommand
+    using subcommand_builder = std::function<void(parser&)>;
+    // runs a selected subcommand, see dispatch
+    using subcommand_handler = std::function<int(parser&)>;
+
+    parser() = default;
+    parser(const parser& rhs) = default;
+    ~parser() = default;
+
+    void usage(const std::string& app_name);
+    // completion candidates for the last word, words are the command line without application name
+    std::vector<std::string> complete(const std::vector<std::string>& words);
+    // bash completion script with the subcommands, flags and option names of every command level
+    std::string bash_completion(const std::string& app_name);
+    // value candidates for an option or positional, throws err_unknown_keyword if there is no such argument
+    parser& set_completer(const keyword& key, value_completer completer);
+
+    // values for options missing on the command line, the command line wins over the environment
+    // and the environment over the config, throws err_unknown_keyword if there is no such option
+    // variables are read when the schema is prepared, so they are read again after the next schema change
+    parser& bind_environment(const keyword& key, std::string variable);
+    parser& bind_config(const keyword& key, std::string config_key);
+    // reads key = value lines, # starts a comment line, later values replace earlier ones
+    // throws err_config_file if the file can't be read
+    parser& load_config(const std::string& path);
+    parser& set_config(std::string config_key, std::string value);
+
+    // constraints between arguments, keys name flags, options or positionals
+    // they are compiled into adjacency lists per argument when the schema is prepared, so a parse only
+    // checks the constraints of the arguments it sees
+    // key given without required fails with err_missing_requirement after the last token
+    parser& add_requirement(const keyword& key, const keyword& required);
+    // both given fails with err_conflicting_arguments at the token of the later one,
+    // an environment or config value conflicting with a given argument is not used,
+    // an argument conflicting with itself fails with err_conflicting_arguments
+    parser& add_conflict(const keyword& key, const keyword& other);
+    // value constraints of options and positionals, violations fail with err_invalid_value at the token
+    // the converted value must be within [min, max], an untyped argument becomes typed as T
+    template<typename T>
+    parser& add_range(const keyword& key, T min, T max);
+    // the value must be one of choices
+    parser& add_choices(const keyword& key, std::vector<std::string> choices);
+
+    // usage text with aligned descriptions wrapped at width, cached until the schema changes
+    // the view stays valid until the next call or schema change
+    std::string_view help(const std::string& app_name, size_t width = 80);
+    void parse(int argc, char **args, storage_mode mode = copy_values);
+    // same as parse, but reports errors instead of throwing
+    parse_status try_parse(int argc, char **args, storage_mode mode = copy_values);
+    // wide argv of wmain and Windows command lines with CommandLineToArgvW rules,
+    // transcoded to UTF-8 in one pass into a buffer of the parser, which view_values refer to until the next wide parse
+    void parse(int argc, wchar_t **args, storage_mode mode = copy_values);
+    parse_status try_parse(int argc, wchar_t **args, storage_mode mode = copy_values);
+    void parse(std::wstring_view command_line, storage_mode mode = copy_values);
+    parse_status try_parse(std::wstring_view command_line, storage_mode mode = copy_values);
+    // lazy parse as prepared_parser::parse_lazy, returns the tokens left unparsed
+    // response files are not expanded
+    token_range<char**> parse_lazy(int argc, char **args, storage_mode mode = copy_values);
+    parse_status try_parse_lazy(int argc, char **args, token_range<char**>& rest, storage_mode mode = copy_values);
+    // parse and run the handler of the innermost selected subcommand that has one
+    // returns its result, or nothing if no such subcommand was selected
+    std::optional<int> dispatch(int argc, char **args, storage_mode mode = copy_values);
+    // measurements of the last parse, all zero unless built with ARGCPP17_ENABLE_STATS
+    inline const parse_statistics& statistics() const { return m_statistics; }
+    
+    inline size_t subcommands() { return m_subcommands.size(); }
+    inline size_t flags() { return m_flags.size(); }
+    inline size_t mandatories() { return m_mandatories.size(); }
+    inline size_t optionals() { return m_optionals.size(); }
+    inline size_t positionals() { return m_positionals.size(); }
+
+    parser& get_subcommand_parser(const keyword& key);
+    // nullptr if there is no such subcommand
+    parser* find_subcommand_parser(const keyword& key);
+
+    // expand @file arguments while parsing, nested response files up to max_depth
+    // in view_values mode values may point into response files, which are kept until the next parse
+    parser& enable_response_files(size_t max_depth = response_expander<char**>::default_depth);
+
+    // option names that are a prefix of other option names, e.g. "--o" and "--out"
+    // longest match wins for those, so "--output" resolves to "--out"
+    inline std::vector<std::string> ambiguous_options() const { return m_option_trie.ambiguous_prefixes(); }
+
+    // keys and descriptions are taken by value and moved into the schema
+    // the returned sub parser reference stays valid while subcommands are added
+    parser& add_subcommand(std::string key, std::string description);
+    // deferred subcommand, builder runs when the subcommand is selected by a parse or its parser is requested
+    // returns this parser instead of the sub parser
+    parser& add_subcommand(std::string key, std::string description, subcommand_builder builder, subcommand_handler handler = nullptr);
+    parser& add_flag(keyword key, std::string description);
+    parser& add_mandatory_argument(keyword key, std::string description);
+    parser& add_optional_argument(keyword key, std::string description);
+    parser& add_argument(keyword key, std::string description, bool optional = true);
+    parser& add_positional(std::string name, std::string description);
+    // optional argument collecting all occurrences instead of keeping the last one
+    parser& add_repeated_argument(keyword key, std::string description);
+    // takes all remaining positional tokens, no positionals can be added after it
+    parser& add_positional_list(std::string name, std::string description);
+
+    // typed variants convert the value once while parsing and cache it for get_value<T>
+    template<typename T>
+    parser& add_mandatory_argument(keyword key, std::string description);
+    template<typename T>
+    parser& add_optional_argument(keyword key, std::string description);
+    template<typename T>
+    parser& add_argument(keyword key, std::string description, bool optional = true);
+    template<typename T>
+    parser& add_positional(std::string name, std::string description);
+    template<typename T>
+    parser& add_repeated_argument(keyword key, std::string description);
+    template<typename T>
+    parser& add_positional_list(std::string name, std::string description);
+
+    // bound variants also write the converted value into target after a successful parse,
+    // get_value and handles still read it from the parser, arguments that are not given leave their variable unchanged
+    // only parse and its variants write variables, parsing with a prepared_parser does not
+    // bound std::string_view variables refer to argv with view_values and to copies in the parser with copy_values
+    parser& add_flag(keyword key, std::string description, bool* target);
+    template<typename T>
+    parser& add_mandatory_argument(keyword key, std::string description, T* target);
+    template<typename T>
+    parser& add_optional_argument(keyword key, std::string description, T* target);
+    template<typename T>
+    parser& add_positional(std::string name, std::string description, T* target);
+    template<typename T>
+    parser& add_repeated_argument(keyword key, std::string description, std::vector<T>* target);
+    template<typename T>
+    parser& add_positional_list(std::string name, std::string description, std::vector<T>* target);
+
+    template<typename T>
+    std::optional<T> get_value(const keyword& key);
+    bool get_flag(const keyword& key);
+    // values of a repeated argument or positional list in command line order
+    // values are views into argv with view_values, with copy_values they are copied into one buffer per argument
+    value_list get_values(const keyword& key) const;
+
+    // handles for reading values in hot loops, see option_handle
+    // an untyped argument becomes typed as T so its values are converted once while parsing,
+    // an argument typed differently fails with err_invalid_value, an unknown key with err_unknown_keyword
+    // std::string_view values refer to copies in the parser unless parsed with view_values
+    template<typename T>
+    option_handle<T> get_handle(const keyword& key);
+    flag_handle get_flag_handle(const keyword& key) const;
+
+    // freeze the current schema for parsing into reusable parse_result objects
+    inline prepared_parser prepare(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const { return prepared_parser(*this, resource); }
+    // schema shared with parse, rebuilt only when the parser changed since the last call
+    // the returned schema is immutable and may be used by any number of threads, each with its own parse_result
+    std::shared_ptr<const prepared_parser> shared_schema();
+    // batch parse against the shared schema, see prepared_parser::parse_batch
+    // deferred subcommands are not built, their command lines fail with err_subcommand_deferred
+    template<typename It>
+    inline void parse_batch(It begin, It end, batch_result& batch, unsigned threads = 0) { shared_schema()->parse_batch(begin, end, batch, threads); }
+
+protected:
+    void parse_vector(std::vector<std::string>& args);
+    parse_status try_parse_vector(std::vector<std::string>& args);
+    
+private:
+    subcommand<parser>* find_subcommand(const keyword& key);
+    void reset();
+    template<typename It>
+    parse_status parse_expanded(It begin, It end, storage_mode mode);
+    template<typename It>
+    void parse_tokens(It begin, It end);
+    void apply(const parse_result& result, storage_mode mode);
+    void apply_result(storage_mode mode);
+    bool build_deferred(const parse_result& result);
+    static bool is_deferred(const parse_result& result);
+    void update_argument(argument& arg, const parse_result& result, size_t slot, storage_mode mode);
+    void changed();
+    ARGCPP17_STATS(
+        void begin_statistics();
+        void end_statistics();
+    )
+
+    static void append_wrapped(std::string& out, std::string_view text, size_t column, size_t width);
+    static void append_completion_words(const prepared_parser& schema, std::string& out);
+    argument* find_argument(const keyword& key, bool positionals);
+    const argument& argument_at(const keyword_index::entry& entry) const;
+    keyword_index::entry find_entry(const keyword& key) const;
+
+    void check_keyword(const keyword& key, keyword_index::kind type, size_t index);
+    void check_option_keyword(const keyword& key, keyword_index::kind type, size_t index);
+
+    // schema and result used by parse, rebuilt when the schema changes
+    std::shared_ptr<const prepared_parser> m_prepared;
+    parse_result m_result;
+    uint64_t m_generation = 0;
+
+    parse_statistics m_statistics;
+
+    // rendered help, valid while the generation matches
+    std::string m_help;
+    std::string m_help_app;
+    size_t m_help_width = 0;
+    uint64_t m_help_generation = UINT64_MAX;
+
+    // config values by key, resolved when the schema is prepared
+    std::unordered_map<std::string, std::string> m_config;
+
+    // pairs of arguments for add_requirement and add_conflict
+    struct constraint {
+        keyword_index::entry first;
+        keyword_index::entry second;
+    };
+    std::vector<constraint> m_requirements;
+    std::vector<constraint> m_conflicts;
+
+    // tokens of the last wide parse
+    wide_command_line m_wide_tokens;
+
+    // response files of the last parse, 0 depth disables expansion
+    std::vector<std::shared_ptr<response_file>> m_response_files;
+    size_t m_response_depth = 0;
+
+    keyword_index m_index;
+    keyword_index m_positional_index;
+    option_trie m_option_trie;
+    std::vector<subcommand<parser>> m_subcommands;
+    std::vector<flag> m_flags;
+    std::vector<mandatory_argument> m_mandatories;
+    std::vector<optional_argument> m_optionals;
+    std::vector<positional_argument> m_positionals;
+};
 
-    if (m_optionals.size()) {
-        std::cout << "flags:" << std::endl;
-        for (auto i : m_flags) {
-            auto key = i.get_key();
-            auto desc = i.get_description();
-            auto full_key = key.get_key();
-            auto abbr_key = key.get_abbreviation();
-            std::cout << "  " << full_key;
-            if (abbr_key.has_value())
-                std::cout << ", " << abbr_key.value();
-            std::cout << ": " << desc;
+template<>
+subcommand<parser>::subcommand(keyword key, std::string description);
+template<>
+subcommand<parser>::subcommand(keyword key, std::string description, std::function<void(parser&)> builder, std::function<int(parser&)> handler);
+template<>
+subcommand<parser>::subcommand(const subcommand<parser>& rhs);
+template<>
+subcommand<parser>& subcommand<parser>::operator=(const subcommand<parser>& rhs);
+template<>
+parser& subcommand<parser>::get_parser();
+
+
+// compile time keyword with optional abbreviation, same shape as keyword
+// declare as namespace scope constant, e.g. inline constexpr static_keyword verbose = {"verbose", "v"};
+struct static_keyword {
+    std::string_view key;
+    std::string_view abbreviation;
+
+    // allows using a static_keyword wherever a runtime keyword is expected
+    operator keyword() const;
+};
+
+
+// compile time argument declarations for static_parser
+template<const static_keyword& Key>
+struct static_flag {
+    using value_type = bool;
+    static constexpr const static_keyword& key = Key;
+    static constexpr keyword_index::kind kind = keyword_index::flag_kind;
+};
+
+template<const static_keyword& Key, typename T>
+struct static_optional {
+    using value_type = std::optional<T>;
+    using parsed_type = T;
+    static constexpr const static_keyword& key = Key;
+    static constexpr keyword_index::kind kind = keyword_index::optional_kind;
+};
+
+template<const static_keyword& Key, typename T>
+struct static_mandatory {
+    using value_type = T;
+    using parsed_type = T;
+    static constexpr const static_keyword& key = Key;
+    static constexpr keyword_index::kind kind = keyword_index::mandatory_kind;
+};
+
+template<const static_keyword& Name, typename T = std::string>
+struct static_positional {
+    using value_type = T;
+    using parsed_type = T;
+    static constexpr const static_keyword& key = Name;
+    static constexpr keyword_index::kind kind = keyword_index::positional_kind;
+};
+
+
+// true if name with prefix, as matched on the command line, equals other with other_prefix
+// dashes a name already starts with are not added again, as in verify_argument_key
+constexpr bool static_same_option(std::string_view prefix, std::string_view name, std::string_view other_prefix, std::string_view other)
+{
+    if (name.empty() || other.empty())
+        return false;
+    auto missing = [](std::string_view prefix, std::string_view name) {
+        size_t dashes = 0;
+        while (dashes < prefix.length() && dashes < name.length() && name[dashes] == prefix[dashes])
+            dashes++;
+        return prefix.length() - dashes;
+    };
+    size_t pad = missing(prefix, name);
+    size_t other_pad = missing(other_prefix, other);
+    if (pad + name.length() != other_pad + other.length())
+        return false;
+    for (size_t i = 0; i < pad + name.length(); i++)
+        if ((i < pad ? '-' : name[i - pad]) != (i < other_pad ? '-' : other[i - other_pad]))
+            return false;
+    return true;
+}
+
+// true if no two flags or options of Args share a key or abbreviation and no two options share
+// a normalized name, positional names may repeat, the same keys the runtime parser rejects
+template<typename... Args>
+constexpr bool static_keys_unique()
+{
+    constexpr size_t count = sizeof...(Args);
+    constexpr std::array<int, count + 1> groups = { (Args::kind == keyword_index::flag_kind ? 0 : Args::kind == keyword_index::positional_kind ? -1 : 1)..., -1 };
+    const std::array<std::string_view, count + 1> keys = { Args::key.key..., {} };
+    const std::array<std::string_view, count + 1> abbreviations = { Args::key.abbreviation..., {} };
+    for (size_t i = 0; i < count; i++)
+        for (size_t j = i + 1; j < count; j++) {
+            if (groups[i] < 0 || groups[j] < 0)
+                continue;
+            // flags and options share one keyword index
+            if (keys[i] == keys[j] || keys[i] == abbreviations[j] || keys[j] == abbreviations[i])
+                return false;
+            if (!abbreviations[i].empty() && abbreviations[i] == abbreviations[j])
+                return false;
+            // options are matched by their names with dashes
+            if (groups[i] == 1 && groups[j] == 1 &&
+                (static_same_option("--", keys[i], "--", keys[j]) ||
+                 static_same_option("--", keys[i], "-", abbreviations[j]) ||
+                 static_same_option("-", abbreviations[i], "--", keys[j]) ||
+                 static_same_option("-", abbreviations[i], "-", abbreviations[j])))
+                return false;
         }
-    }
+    return true;
+}
+
+
+// argument parser with a schema fixed at compile time
+// keyword matching is generated by the compiler and values are stored as typed struct members,
+// so there is no virtual dispatch and no heap allocated schema
+template<typename... Args>
+class static_parser {
+    static_assert(static_keys_unique<Args...>(), "static_parser keys and abbreviations must be unique");
+
+public:
+    using values_type = std::tuple<typename Args::value_type...>;
+
+    static_parser() = default;
+    ~static_parser() = default;
+
+    void parse(int argc, char **args);
+    // same as parse, but reports errors instead of throwing
+    parse_status try_parse(int argc, char **args);
+
+    template<typename Arg>
+    inline const auto& get() const { return std::get<index_of<Arg>()>(m_values); }
+    template<typename Arg>
+    inline bool is_parsed() const { return m_parsed[index_of<Arg>()]; }
+    inline const values_type& values() const { return m_values; }
+
+protected:
+    void parse_vector(std::vector<std::string>& args);
+
+private:
+    using args_type = std::tuple<Args...>;
+    template<size_t I>
+    using arg_type = std::tuple_element_t<I, args_type>;
+    static constexpr size_t npos = sizeof...(Args);
+
+    template<typename Arg, size_t I = 0>
+    static constexpr size_t index_of();
+    template<size_t I>
+    static constexpr size_t positional_ordinal();
+    static constexpr size_t positional_count();
+    static constexpr size_t prefix_length(std::string_view prefix, std::string_view name, std::string_view arg);
+    static constexpr size_t option_length(const static_keyword& key, std::string_view arg);
+
+    template<typename It>
+    parse_status parse_tokens(It begin, It end);
+    template<size_t... I>
+    void find_option(std::string_view arg, size_t& index, size_t& length, std::index_sequence<I...>) const;
+    template<size_t... I>
+    bool parse_flag(std::string_view arg, std::index_sequence<I...>);
+    template<size_t... I>
+    bool parse_positional(std::string_view arg, size_t ordinal, bool& valid, std::index_sequence<I...>);
+    template<size_t... I>
+    bool update_value(size_t index, std::string_view value, std::index_sequence<I...>);
+    template<size_t... I>
+    bool check_mandatory(std::index_sequence<I...>) const;
+    template<size_t I>
+    bool update_value(std::string_view value);
+
+    values_type m_values;
+    std::array<bool, sizeof...(Args)> m_parsed = {};
+};
+
+
+
+
+// ====================================================
+// IMPLEMENTATIONS
+// ====================================================
+
+template<typename T>
+bool convert_value(std::string_view value, T& result)
+{
+    return value_converter<T>::convert(value, result);
+}
+
+template<typename T, size_t I>
+constexpr uint8_t builtin_value_type()
+{
+    if constexpr (I == std::tuple_size_v<builtin_value_types>)
+        return custom_value_type;
+    else if constexpr (std::is_same_v<T, std::tuple_element_t<I, builtin_value_types>>)
+        return static_cast<uint8_t>(I + 1);
+    else
+        return builtin_value_type<T, I + 1>();
+}
+
+template<typename T>
+bool convert_cached(std::string_view value, std::any& cache)
+{
+    T converted{};
+    if (!convert_value(value, converted))
+        return false;
+    cache = std::move(converted);
+    return true;
+}
+
+template<size_t... I>
+constexpr std::array<bool (*)(std::string_view, std::any&), sizeof...(I)> builtin_converters(std::index_sequence<I...>)
+{
+    return {{ &convert_cached<std::tuple_element_t<I, builtin_value_types>>... }};
+}
+
+template<typename T>
+long double cached_number(const std::any& cache)
+{
+    return static_cast<long double>(*std::any_cast<T>(&cache));
+}
+
+template<typename T>
+constexpr long double (*cached_number_of())(const std::any&)
+{
+    if constexpr (std::is_arithmetic_v<T>)
+        return &cached_number<T>;
+    else
+        return nullptr;
+}
+
+template<size_t... I>
+constexpr std::array<long double (*)(const std::any&), sizeof...(I)> builtin_numbers(std::index_sequence<I...>)
+{
+    return {{ cached_number_of<std::tuple_element_t<I, builtin_value_types>>()... }};
+}
+
+template<typename T>
+T parse_value(std::string_view value)
+{
+    T casted{};
+    if (!convert_value(value, casted))
+        ARGCPP17_THROW(argcpp17_exception::err_invalid_value);
+    return casted;
+}
+
+template<typename T>
+T parse_value(const std::string& value)
+{
+    return parse_value<T>(std::string_view(value));
+}
+
+
+template<typename T>
+std::optional<T> parse_value(const std::optional<std::string>& value)
+{
+    if (!value.has_value())
+        return std::nullopt;
+    return parse_value<T>(value.value());
+}
+
+
+//argument implementations
+template<typename T>
+const T* argument::cached_value() const
+{
+    // an empty cache would compare type names
+    return m_cache.get().has_value() ? std::any_cast<T>(&m_cache.get()) : nullptr;
+}
+
+template<typename T>
+void argument::set_type()
+{
+    m_converter = &convert_cached<T>;
+    m_value_type = builtin_value_type<T>();
+}
+
+template<typename T>
+void argument::bind_value(T* target)
+{
+    set_type<T>();
+    m_target = target;
+    m_binder = [](const std::any& cache, value_list, const std::any*, void* target) {
+        if (auto value = std::any_cast<T>(&cache))
+            *static_cast<T*>(target) = *value;
+    };
+}
 
-    if (m_positionals.size()) {
-        std::cout << "positional arguments:" << std::endl;
-        for (auto i : m_positionals) {
-            auto key = i.get_key();
-            auto desc = i.get_description();
-            auto full_key = key.get_key();
-            auto abbr_key = key.get_abbreviation();
-            std::cout << "  " << full_key;
-            if (abbr_key.has_value())
-                std::cout << ", " << abbr_key.value();
-            std::cout << ": " << desc;
+template<typename T>
+void argument::bind_list(std::vector<T>* target)
+{
+    set_type<T>();
+    m_target = target;
+    m_binder = [](const std::any&, value_list values, const std::any* converted, void* target) {
+        // values were converted and validated while parsing, views are taken as they are
+        auto& list = *static_cast<std::vector<T>*>(target);
+        if constexpr (std::is_same_v<T, std::string_view>) {
+            list.assign(values.begin(), values.end());
+        } else {
+            list.clear();
+            list.reserve(values.size());
+            for (size_t i = 0; converted && i < values.size(); i++)
+                if (auto value = std::any_cast<T>(&converted[i]))
+                    list.push_back(*value);
         }
-    }
+    };
 }
 
-void parser::parse(int argc, char **args) {
-    // create string vector from argument and remove first argument
-    auto arg_vector = std::vector<std::string>(&args[1], &args[1] + argc - 1);
-    parse_vector(arg_vector);
+
+//keyword_index implementations
+template<typename Predicate>
+bool keyword_index::all_of(Predicate predicate) const
+{
+    for (auto& s : m_slots)
+        if (s.value.type != none && !predicate(s.value))
+            return false;
+    return true;
 }
 
-auto parser::get_subcommand(const keyword& key)
+
+//option_trie implementations
+template<typename Predicate>
+bool option_trie::all_of(Predicate predicate) const
 {
-    auto it = std::find_if(m_subcommands.begin(), m_subcommands.end(), [&](const subcommand<parser>& item) { return item == key; });
-    if (it == m_subcommands.end())
-        throw argcpp17_exception(argcpp17_exception::err_subcommand_not_found);
-    return it;
+    for (auto& n : m_nodes)
+        if (n.terminal && !predicate(n.value))
+            return false;
+    return true;
 }
 
-parser& parser::get_subcommand_parser(const keyword& key)
+
+//schema_writer implementations
+template<typename T>
+void schema_writer::write(const T& value)
 {
-    return get_subcommand(key)->get_parser();
+    static_assert(std::is_trivially_copyable_v<T>);
+    if constexpr (std::is_same_v<T, bool>)
+        write(static_cast<uint8_t>(value));
+    else if constexpr (std::is_floating_point_v<T>)
+        m_image.append(reinterpret_cast<const char*>(&value), schema_float_bytes<T>());
+    else if constexpr (std::has_unique_object_representations_v<T>)
+        m_image.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    else
+        T::fields(value, [this](const auto& field) { write(field); });
 }
 
-void parser::check_keyword(const keyword& key)
+template<typename T, typename Allocator>
+void schema_writer::write(const std::vector<T, Allocator>& values)
 {
-    if (std::find(m_keywords.begin(), m_keywords.end(), key) != m_keywords.end())
-        throw argcpp17_exception(argcpp17_exception::err_duplicate_keyword);
-    m_keywords.push_back(key);
+    static_assert(std::is_trivially_copyable_v<T>);
+    write(static_cast<uint32_t>(values.size()));
+    if constexpr (std::has_unique_object_representations_v<T> && !std::is_same_v<T, bool>)
+        m_image.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    else
+        for (auto& value : values)
+            write(value);
 }
 
-parser& parser::add_subcommand(const std::string& key, const std::string& description)
+template<typename T, size_t N>
+void schema_writer::write(const std::array<T, N>& values)
 {
-    keyword kw = { key };
-    check_keyword(kw);
-    m_subcommands.push_back(subcommand<parser>(kw, description));
-    return m_subcommands.back().get_parser();
+    for (auto& value : values)
+        write(value);
 }
 
-parser& parser::add_flag(const keyword& key, const std::string& description)
+template<typename Traits, typename Allocator>
+void schema_writer::write(const std::basic_string<char, Traits, Allocator>& value)
 {
-    check_keyword(key);
-    m_flags.push_back(flag(key, description));
-    return *this;
+    write(static_cast<uint32_t>(value.size()));
+    m_image.append(value.data(), value.size());
 }
 
-parser& parser::add_mandatory_argument(const keyword& key, const std::string& description)
+
+//schema_reader implementations
+template<typename T>
+void schema_reader::read(T& value)
 {
-    check_keyword(key);
-    m_mandatories.push_back(mandatory_argument(key, description));
-    return *this;
+    static_assert(std::is_trivially_copyable_v<T>);
+    if constexpr (std::is_same_v<T, bool>) {
+        uint8_t byte = 0;
+        read(byte);
+        value = byte != 0;
+    } else if constexpr (std::is_floating_point_v<T>) {
+        value = T();
+        std::memcpy(&value, take(schema_float_bytes<T>()), schema_float_bytes<T>());
+    } else if constexpr (std::has_unique_object_representations_v<T>)
+        std::memcpy(&value, take(sizeof(T)), sizeof(T));
+    else
+        T::fields(value, [this](auto& field) { read(field); });
 }
 
-parser& parser::add_optional_argument(const keyword& key, const std::string& description)
+template<typename T, typename Allocator>
+void schema_reader::read(std::vector<T, Allocator>& values)
 {
-    check_keyword(key);
-    m_optionals.push_back(optional_argument(key, description));
-    return *this;
+    static_assert(std::is_trivially_copyable_v<T>);
+    uint32_t size = 0;
+    read(size);
+    if constexpr (std::has_unique_object_representations_v<T> && !std::is_same_v<T, bool>) {
+        auto data = take(size * sizeof(T));
+        values.resize(size);
+        if (size)
+            std::memcpy(values.data(), data, size * sizeof(T));
+    } else {
+        // the size is checked against the rest of the image before allocating
+        if (size > m_image.size() / record_bytes<T>())
+            ARGCPP17_THROW(argcpp17_exception::err_invalid_schema_image);
+        values.resize(size);
+        for (auto& value : values)
+            read(value);
+    }
 }
 
-parser& parser::add_argument(const keyword& key, const std::string& description, bool optional)
+template<typename T, size_t N>
+void schema_reader::read(std::array<T, N>& values)
 {
-    return optional ? add_optional_argument(key, description) : add_mandatory_argument(key, description);
+    for (auto& value : values)
+        read(value);
 }
 
-parser& parser::add_positional(const std::string& name, const std::string& description)
-{    
-    m_positionals.push_back(positional_argument(name, description));
-    return *this;
+template<typename Traits, typename Allocator>
+void schema_reader::read(std::basic_string<char, Traits, Allocator>& value)
+{
+    uint32_t size = 0;
+    read(size);
+    value.assign(take(size), size);
 }
 
-void parser::parse_vector(std::vector<std::string>& args)
+template<typename T>
+size_t schema_reader::record_bytes()
 {
-    // reset
-    for (auto &it : m_subcommands) it.reset();
-    for (auto &it : m_flags) it.reset();
-    for (auto &it : m_optionals) it.reset();
-    for (auto &it : m_mandatories) it.reset();
-    for (auto &it : m_positionals) it.reset();
+    if constexpr (std::is_same_v<T, bool>)
+        return 1;
+    else if constexpr (std::is_floating_point_v<T>)
+        return schema_float_bytes<T>();
+    else if constexpr (std::has_unique_object_representations_v<T>)
+        return sizeof(T);
+    else {
+        size_t bytes = 0;
+        T value{};
+        T::fields(value, [&bytes](auto& field) { bytes += record_bytes<std::decay_t<decltype(field)>>(); });
+        return bytes;
+    }
+}
 
-    if (args.size())
-        //  we hit a subcommand, so we are done here
-        if (parse_subcommand(args))
+
+//response_expander implementations
+template<typename It>
+response_expander<It>::response_expander(It begin, It end, std::vector<std::shared_ptr<response_file>>& files, size_t max_depth)
+    : m_it(begin)
+    , m_end(end)
+    , m_files(files)
+    , m_max_depth(max_depth)
+{}
+
+template<typename It>
+typename response_expander<It>::iterator response_expander<It>::begin()
+{
+    if (!m_started) {
+        m_started = true;
+        next();
+    }
+    return iterator(this);
+}
+
+template<typename It>
+void response_expander<It>::next()
+{
+    while (!m_done) {
+        std::string_view token;
+        bool quoted = false;
+        if (!m_stack.empty()) {
+            if (!next_token(m_stack.back(), token, quoted)) {
+                m_stack.pop_back();
+                continue;
+            }
+        } else if (m_it != m_end) {
+            token = *m_it;
+            ++m_it;
+        } else {
+            m_done = true;
             return;
-    parse_options(args);
-    parse_flags(args);
-    parse_positionals(args);    
+        }
+
+        if (!quoted && token.length() > 1 && token.front() == '@') {
+            if (!expand(token))
+                m_done = true;
+            continue;
+        }
+        m_current = token;
+        m_index++;
+        return;
+    }
 }
 
-bool parser::parse_subcommand(std::vector<std::string>& args)
+template<typename It>
+bool response_expander<It>::next_token(frame& current, std::string_view& token, bool& quoted)
 {
-    try {
-        auto sub_command = get_subcommand(args.front());
-        args.erase(args.begin());
-        sub_command->get_parser().parse_vector(args);
-        sub_command->mark_parsed();
-        return true;
-    } catch (argcpp17_exception& e) {
-        // first argument is no subcommand
-        // TODO: 
-        // - maybe should rethrow this exception if a subcommand MUST be specified
-        // - parser flag or automatic if no other arguments found in parser
+    auto is_space = [](char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f'; };
+    char* data = current.file->data();
+    size_t size = current.file->size();
+    size_t& pos = current.position;
+
+    while (pos < size && is_space(data[pos]))
+        pos++;
+    if (pos == size)
+        return false;
+
+    // unescaping only shrinks the token, so it is written back in place
+    size_t start = pos;
+    size_t out = pos;
+    char quote = 0;
+    for (; pos < size; pos++) {
+        char c = data[pos];
+        if (quote == '\'') {
+            if (c == '\'') {
+                quote = 0;
+                continue;
+            }
+        } else if (c == '\\' && pos + 1 < size)
+            c = data[++pos];
+        else if (c == '"') {
+            quote = quote ? 0 : '"';
+            quoted = true;
+            continue;
+        } else if (c == '\'' && !quote) {
+            quote = '\'';
+            quoted = true;
+            continue;
+        } else if (!quote && is_space(c))
+            break;
+        data[out++] = c;
     }
-    return false;
+    token = std::string_view(data + start, out - start);
+    return true;
 }
 
-void parser::parse_flags(std::vector<std::string>& args)
+template<typename It>
+bool response_expander<It>::expand(std::string_view token)
 {
-    auto it = args.begin();
-    while (it != args.end()) {
-        auto f = std::find_if(m_flags.begin(), m_flags.end(), [&](const flag& item) { return item == *it; });
-        if (f == m_flags.end())
-            it++;
-        else {
-            f->mark_parsed();
-            it = args.erase(it);
-        }
+    if (m_stack.size() >= m_max_depth) {
+        m_status = parse_status{ false, argcpp17_exception::err_response_file_depth, m_index };
+        return false;
+    }
+    auto file = std::make_shared<response_file>();
+    if (!file->open(std::string(token.substr(1)))) {
+        m_status = parse_status{ false, argcpp17_exception::err_response_file, m_index };
+        return false;
     }
+    m_files.push_back(file);
+    m_stack.push_back({ file.get(), 0 });
+    return true;
 }
 
-auto parser::check_value_type(const std::string& key, const std::string& arg)
+
+//parse_result implementations
+template<typename T>
+std::optional<T> parse_result::get_value(const keyword& key) const
 {
-    if (arg.substr(key.length(), 1) == "=")
-        return std::make_pair<>(parser::equal_sign, arg.substr(key.length() + 1));
-    else if (arg.substr(key.length(), 1) == ":")
-        return std::make_pair<>(parser::colon, arg.substr(key.length() + 1));
-    else
-        return std::make_pair<>(parser::one_string, arg.substr(key.length()));
+    auto slot = find_value_slot(key);
+    if (slot == npos || !m_parsed[slot])
+        return std::nullopt;
+    if (auto cached = std::any_cast<T>(&m_cache[slot]))
+        return *cached;
+    return parse_value<T>(m_values[slot]);
 }
 
 template<typename T>
-auto parser::parse_argument_value(const std::string& arg, T begin, T end)
+const T* parse_result::get(const option_handle<T>& handle) const
 {
-    argument_value_type value_type = none;
-    std::string value;
-    auto a = std::find_if(begin, end, [&](const argument& item) 
-    { 
-        auto keyword = verify_argument_key(item.get_key());
-        auto key = keyword.get_key();
-        auto abbr = keyword.get_abbreviation();
+    if (!m_schema || handle.m_entry.type == keyword_index::none)
+        return nullptr;
+    auto slot = m_schema->slot(handle.m_entry);
+    if (slot >= m_parsed.size() || !m_parsed[slot] || !m_cache[slot].has_value())
+        return nullptr;
+    return std::any_cast<T>(&m_cache[slot]);
+}
 
-        // argument key and value seperated by whitespace
-        if (key == arg || (abbr.has_value() && abbr.value() == arg)) {
-            value_type = parser::whitespace;
-            return true;
-        }
 
-        // argument as one string or with seperating char ('=' or ':')
-        if (arg.length() > key.length() && arg.substr(0, key.length()) == key) {
-            std::tie(value_type, value) = check_value_type(key, arg);
-            return true;
+//prepared_parser implementations
+template<typename It>
+void prepared_parser::complete(It begin, It end, std::string_view word, std::vector<std::string>& candidates) const
+{
+    candidates.clear();
+
+    // follow subcommands and count positionals, values are not converted
+    const prepared_parser* schema = this;
+    bool first = true;
+    size_t positional = 0;
+    for (auto it = begin; it != end; ++it) {
+        std::string_view arg = *it;
+        if (first) {
+            first = false;
+            auto entry = schema->m_index.find(arg, keyword_index::subcommand_kind);
+            if (entry) {
+                schema = &schema->m_subcommands[entry->index];
+                first = true;
+                continue;
+            }
         }
-        
-        if (!abbr.has_value())
-            return false;
-        auto abbr_val = abbr.value();
-        if (arg.length() > abbr_val.length() && arg.substr(0, abbr_val.length()) == abbr_val) {
-            std::tie(value_type, value) = check_value_type(abbr_val, arg);
-            return true;
+
+        size_t length = 0;
+        auto entry = schema->m_option_trie.longest_prefix(arg, length);
+        if (entry) {
+            if (length == arg.length()) {
+                // value is the next token, which may be the word to complete
+                if (std::next(it) == end) {
+                    schema->complete_value(schema->slot(*entry), std::string_view(), word, candidates);
+                    return;
+                }
+                ++it;
+            }
+            continue;
         }
-        return false;
-    });
+        if (schema->m_index.find(arg, keyword_index::flag_kind))
+            continue;
+        if (positional < schema->m_positionals && !schema->m_repeated[schema->positional_slot(positional)])
+            positional++;
+    }
+    schema->complete_word(word, first, positional, candidates);
+}
 
-    return std::make_tuple<>(a != end ? (argument*) &(*a) : nullptr, value_type, value);
+
+template<typename It>
+bool prepared_parser::parse(It begin, It end, parse_result& result) const
+{
+    return parse_tokens(begin, end, 0, result);
 }
 
-auto parser::parse_argument_value(const std::string& arg)
-{    
-    auto [mandatory_arg, mandatory_type, madatory_value] = parse_argument_value(arg, m_mandatories.begin(), m_mandatories.end());
-    auto [optional_arg, optional_type, optional_value]  = parse_argument_value(arg, m_optionals.begin(), m_optionals.end());
-    return std::make_tuple<>((argument*)((uintptr_t) mandatory_arg | (uintptr_t) optional_arg), mandatory_type | optional_type, mandatory_arg ? madatory_value : optional_value);
+
+template<typename It>
+bool prepared_parser::parse_lazy(It begin, It end, parse_result& result, token_range<It>& rest) const
+{
+    rest.last = end;
+    return parse_tokens(begin, end, 0, result, &rest.first);
 }
 
-void parser::parse_options(std::vector<std::string>& args)
+
+template<typename It>
+void prepared_parser::parse_batch(It begin, It end, batch_result& batch, unsigned threads) const
 {
-    auto it = args.begin();
-    while (it != args.end()) {
-        auto [argument, type, value] = parse_argument_value(*it);
-        if (argument) {
-            argument->mark_parsed();
-            switch (type)
-            {
-            case one_string:
-            case equal_sign:
-            case colon:
-                break;
-            case whitespace:
-                it = args.erase(it);
+    // chunks start at any line, so the lines need constant time access
+    static_assert(std::is_base_of_v<std::random_access_iterator_tag, typename std::iterator_traits<It>::iterator_category>,
+                  "parse_batch needs random access iterators");
+    batch.resize(static_cast<size_t>(std::distance(begin, end)));
+    run_parallel(batch.size(), threads, [this, begin, &batch](size_t first, size_t last) {
+        auto line = std::next(begin, static_cast<typename std::iterator_traits<It>::difference_type>(first));
+        for (size_t i = first; i < last; i++, ++line) {
+            auto& result = batch.results[i];
+            batch.ok[i] = parse(std::begin(*line), std::end(*line), result);
+            batch.errors[i] = result.error();
+            batch.error_indices[i] = result.error_index();
+        }
+    });
+}
+
+
+// single forward pass: every token is classified once as option, flag or positional
+template<typename It>
+bool prepared_parser::parse_tokens(It begin, It end, size_t offset, parse_result& result, It* rest) const
+{
+    result.prepare(*this);
+    if (rest)
+        *rest = end;
+
+    if (begin != end) {
+        ARGCPP17_STATS(phase_timer timer(result.m_statistics);)
+        auto entry = m_index.find(*begin, keyword_index::subcommand_kind);
+        //  we hit a subcommand, so we are done here
+        if (entry) {
+            auto& sub_result = result.subcommand_result(entry->index);
+            if (m_subcommands[entry->index].is_deferred()) {
+                // the selected subcommand is kept, so the caller knows which one to build
+                sub_result.prepare(m_subcommands[entry->index]);
+                return result.fail(argcpp17_exception::err_subcommand_deferred, offset);
+            }
+            ARGCPP17_STATS(
+                sub_result.m_statistics = result.m_statistics;
+                if (result.m_statistics) {
+                    result.m_statistics->tokens++;
+                    result.m_statistics->subcommand_path.push_back(entry->index);
+                }
+                timer.stop(&parse_statistics::subcommand_time);
+            )
+            if (!m_subcommands[entry->index].parse_tokens(std::next(begin), end, offset + 1, sub_result, rest))
+                return result.fail(sub_result.error(), sub_result.error_index());
+            return true;
+        }
+        ARGCPP17_STATS(timer.stop(&parse_statistics::subcommand_time);)
+    }
+
+    size_t index = offset;
+    size_t positional = 0;
+    size_t unknown = parse_result::npos;
+    for (auto it = begin; it != end; ++it, ++index) {
+        std::string_view arg = *it;
+        ARGCPP17_STATS(
+            phase_timer timer(result.m_statistics);
+            if (result.m_statistics)
+                result.m_statistics->tokens++;
+        )
+
+        size_t length = 0;
+        auto entry = may_be_option(arg) ? m_option_trie.longest_prefix(arg, length) : nullptr;
+        if (entry) {
+            std::string_view value;
+            if (length == arg.length()) {
+                // argument key and value seperated by whitespace
+                if (++it == end)
+                    return result.fail(argcpp17_exception::err_missing_value, index);
+                ++index;
                 value = *it;
-                break;
-            default:
-                break;
+                ARGCPP17_STATS(if (result.m_statistics) result.m_statistics->tokens++;)
+            } else
+                // argument as one string or with seperating char ('=' or ':')
+                value = check_value_type(arg.substr(0, length), arg).second;
+            if (conflicts(slot(*entry), result))
+                return result.fail(argcpp17_exception::err_conflicting_arguments, index);
+            if (!update_value(slot(*entry), value, result))
+                return result.fail(argcpp17_exception::err_invalid_value, index);
+            ARGCPP17_STATS(timer.stop(&parse_statistics::options_time);)
+            continue;
+        }
+
+        entry = may_be_flag(arg) ? m_index.find(arg, keyword_index::flag_kind) : nullptr;
+        if (entry) {
+            if (conflicts(entry->index, result))
+                return result.fail(argcpp17_exception::err_conflicting_arguments, index);
+            result.m_parsed[entry->index] = 1;
+            ARGCPP17_STATS(timer.stop(&parse_statistics::flags_time);)
+            continue;
+        }
+
+        // cluster of single character abbreviations, the last one may take a value: -xvf out.tar
+        if (is_cluster(arg)) {
+            size_t i = 1;
+            for (; i < arg.length() && m_short_options[static_cast<unsigned char>(arg[i])].type == keyword_index::flag_kind; i++) {
+                auto flag = m_short_options[static_cast<unsigned char>(arg[i])].index;
+                if (conflicts(flag, result))
+                    return result.fail(argcpp17_exception::err_conflicting_arguments, index);
+                result.m_parsed[flag] = 1;
             }
-            argument->update_value(value);
-            it = args.erase(it);
-        } else 
-            it++;
+            if (i < arg.length()) {
+                auto& option = m_short_options[static_cast<unsigned char>(arg[i])];
+                auto value = arg.substr(i + 1);
+                if (value.empty()) {
+                    if (++it == end)
+                        return result.fail(argcpp17_exception::err_missing_value, index);
+                    ++index;
+                    value = *it;
+                    ARGCPP17_STATS(if (result.m_statistics) result.m_statistics->tokens++;)
+                } else if (value.front() == '=' || value.front() == ':')
+                    value.remove_prefix(1);
+                if (conflicts(slot(option), result))
+                    return result.fail(argcpp17_exception::err_conflicting_arguments, index);
+                if (!update_value(slot(option), value, result))
+                    return result.fail(argcpp17_exception::err_invalid_value, index);
+            }
+            ARGCPP17_STATS(timer.stop(&parse_statistics::flags_time);)
+            continue;
+        }
+
+        // lazy parsing leaves everything behind the separator or the declared positionals untouched
+        if (rest && arg == "--") {
+            *rest = std::next(it);
+            break;
+        }
+        if (rest && (positional == m_positionals || m_repeated[positional_slot(positional)])) {
+            *rest = it;
+            break;
+        }
+
+        if (positional < m_positionals) {
+            auto slot = positional_slot(positional);
+            if (conflicts(slot, result))
+                return result.fail(argcpp17_exception::err_conflicting_arguments, index);
+            if (!update_value(slot, arg, result))
+                return result.fail(argcpp17_exception::err_invalid_value, index);
+            // a positional list stays the current positional
+            if (!m_repeated[slot])
+                positional++;
+        } else if (unknown == parse_result::npos)
+            unknown = index;
+        ARGCPP17_STATS(timer.stop(&parse_statistics::positionals_time);)
     }
-    check_mandatory();    
+
+    // environment and config values for everything not on the command line
+    for (auto& value : m_fallbacks)
+        if (!result.m_parsed[value.slot] && !conflicts(value.slot, result) &&
+            !update_value(value.slot, std::string_view(m_fallback_values).substr(value.offset, value.length), result))
+            return result.fail(argcpp17_exception::err_invalid_value, index);
+    result.collect_lists();
+
+    // keep error precedence of mandatory before positional checks
+    for (size_t i = 0; i < m_mandatories; i++)
+        if (!result.m_parsed[mandatory_slot(i)])
+            return result.fail(argcpp17_exception::err_missing_mandatory, index);
+    for (auto& requirement : m_requirements)
+        if (result.m_parsed[requirement.slot] && !result.m_parsed[requirement.required])
+            return result.fail(argcpp17_exception::err_missing_requirement, index);
+    if (unknown != parse_result::npos)
+        return result.fail(argcpp17_exception::err_unknown_arguments, unknown);
+    // the positional list may be empty
+    if (positional < m_positionals - (m_positional_list ? 1 : 0))
+        return result.fail(argcpp17_exception::err_missing_positionals, index);
+    return true;
 }
 
-void parser::parse_positionals(std::vector<std::string>& args)
-{
-    if (args.size() > m_positionals.size())
-        throw argcpp17_exception(argcpp17_exception::err_unknown_arguments);
-    else if (args.size() < m_positionals.size())
-        throw argcpp17_exception(argcpp17_exception::err_missing_positionals);
 
-    auto arg = args.begin();
-    auto pos = m_positionals.begin();
-    while (arg != args.end()) {
-        pos->update_value(*arg);
-        pos->mark_parsed();
-        arg++;
-        pos++;
+//parser implementations
+template<typename It>
+parse_status parser::parse_expanded(It begin, It end, storage_mode mode)
+{
+    // a parse selecting a deferred subcommand builds it and starts over
+    for (;;) {
+        m_response_files.clear();
+        if (!m_response_depth)
+            parse_tokens(begin, end);
+        else {
+            response_expander<It> expander(begin, end, m_response_files, m_response_depth);
+            parse_tokens(expander.begin(), expander.end());
+            // a failing response file ends the tokens early, report that instead of the follow-up error
+            // and keep the values of the tokens read so far out of the parser
+            if (!expander.status())
+                return expander.status();
+        }
+        if (!is_deferred(m_result)) {
+            apply_result(mode);
+            return m_result.status();
+        }
+        if (!build_deferred(m_result))
+            return m_result.status();
     }
-    check_positional();
 }
 
-void parser::check_positional()
+
+template<typename It>
+void parser::parse_tokens(It begin, It end)
 {
-    for (auto &positional : m_positionals)
-        if (!positional.is_parsed())
-            throw argcpp17_exception(argcpp17_exception::err_missing_positional);
+    ARGCPP17_STATS(begin_statistics();)
+    shared_schema()->parse(begin, end, m_result);
+    ARGCPP17_STATS(end_statistics();)
 }
 
-void parser::check_mandatory()
+
+template<typename T>
+parser& parser::add_mandatory_argument(keyword key, std::string description)
 {
-    for (auto &mandatory : m_mandatories)
-        if (!mandatory.is_parsed())
-            throw argcpp17_exception(argcpp17_exception::err_missing_mandatory);
+    add_mandatory_argument(std::move(key), std::move(description));
+    m_mandatories.back().set_type<T>();
+    return *this;
 }
 
 template<typename T>
-auto parser::find_option(const keyword& key, T begin, T end)
+parser& parser::add_optional_argument(keyword key, std::string description)
 {
-    return std::find_if(begin, end, [&](const argument& item) 
-    { 
-        return item == key;
-    });
+    add_optional_argument(std::move(key), std::move(description));
+    m_optionals.back().set_type<T>();
+    return *this;
+}
+
+template<typename T>
+parser& parser::add_argument(keyword key, std::string description, bool optional)
+{
+    if (optional)
+        return add_optional_argument<T>(std::move(key), std::move(description));
+    return add_mandatory_argument<T>(std::move(key), std::move(description));
+}
+
+template<typename T>
+parser& parser::add_positional(std::string name, std::string description)
+{
+    add_positional(std::move(name), std::move(description));
+    m_positionals.back().set_type<T>();
+    return *this;
 }
 
 template<typename T>
 std::optional<T> parser::get_value(const keyword& key)
 {
-    {
-        auto it = find_option(key, m_optionals.begin(), m_optionals.end());
-        if (it != m_optionals.end())
-            return it->value<T>();
-    }
-    {
-        auto it = find_option(key, m_mandatories.begin(), m_mandatories.end());
-        if (it != m_mandatories.end())
-            return it->value<T>();
+    auto entry = m_index.find_keyword(key, keyword_index::optional_kind | keyword_index::mandatory_kind);
+    if (entry && entry->type == keyword_index::optional_kind)
+        return m_optionals[entry->index].value<T>();
+    if (entry && entry->type == keyword_index::mandatory_kind)
+        return m_mandatories[entry->index].value<T>();
+    entry = m_positional_index.find_keyword(key);
+    if (entry)
+        return m_positionals[entry->index].value<T>();
+    return std::nullopt;
+}
+
+template<typename T>
+parser& parser::add_repeated_argument(keyword key, std::string description)
+{
+    add_repeated_argument(std::move(key), std::move(description));
+    m_optionals.back().set_type<T>();
+    return *this;
+}
+
+template<typename T>
+parser& parser::add_positional_list(std::string name, std::string description)
+{
+    add_positional_list(std::move(name), std::move(description));
+    m_positionals.back().set_type<T>();
+    return *this;
+}
+
+template<typename T>
+parser& parser::add_mandatory_argument(keyword key, std::string description, T* target)
+{
+    add_mandatory_argument(std::move(key), std::move(description));
+    m_mandatories.back().bind_value(target);
+    return *this;
+}
+
+template<typename T>
+parser& parser::add_optional_argument(keyword key, std::string description, T* target)
+{
+    add_optional_argument(std::move(key), std::move(description));
+    m_optionals.back().bind_value(target);
+    return *this;
+}
+
+template<typename T>
+parser& parser::add_positional(std::string name, std::string description, T* target)
+{
+    add_positional(std::move(name), std::move(description));
+    m_positionals.back().bind_value(target);
+    return *this;
+}
+
+template<typename T>
+parser& parser::add_repeated_argument(keyword key, std::string description, std::vector<T>* target)
+{
+    add_repeated_argument(std::move(key), std::move(description));
+    m_optionals.back().bind_list(target);
+    return *this;
+}
+
+template<typename T>
+parser& parser::add_positional_list(std::string name, std::string description, std::vector<T>* target)
+{
+    add_positional_list(std::move(name), std::move(description));
+    m_positionals.back().bind_list(target);
+    return *this;
+}
+
+template<typename T>
+parser& parser::add_range(const keyword& key, T min, T max)
+{
+    static_assert(std::is_arithmetic_v<T>, "ranges need an arithmetic type");
+    auto arg = find_argument(key, true);
+    if (!arg->m_converter)
+        arg->set_type<T>();
+    else if (arg->m_converter != &convert_cached<T>)
+        ARGCPP17_THROW(argcpp17_exception::err_invalid_value);
+    arg->m_number = &cached_number<T>;
+    arg->m_min = static_cast<long double>(min);
+    arg->m_max = static_cast<long double>(max);
+    changed();
+    return *this;
+}
+
+template<typename T>
+option_handle<T> parser::get_handle(const keyword& key)
+{
+    auto entry = m_index.find_keyword(key, keyword_index::optional_kind | keyword_index::mandatory_kind);
+    if (!entry)
+        entry = m_positional_index.find_keyword(key);
+    if (!entry)
+        ARGCPP17_THROW(argcpp17_exception::err_unknown_keyword);
+
+    auto& arg = const_cast<argument&>(argument_at(*entry));
+    if (!arg.m_converter) {
+        arg.set_type<T>();
+        changed();
+    } else if (arg.m_converter != &convert_cached<T>)
+        ARGCPP17_THROW(argcpp17_exception::err_invalid_value);
+    return option_handle<T>(this, *entry);
+}
+
+
+//option_handle implementations
+template<typename T>
+const T* option_handle<T>::get() const
+{
+    return m_parser ? m_parser->argument_at(m_entry).template cached_value<T>() : nullptr;
+}
+
+
+//static_parser implementations
+template<typename... Args>
+template<typename Arg, size_t I>
+constexpr size_t static_parser<Args...>::index_of()
+{
+    static_assert(I < sizeof...(Args), "argument is not part of this static_parser");
+    if constexpr (std::is_same_v<Arg, arg_type<I>>)
+        return I;
+    else
+        return index_of<Arg, I + 1>();
+}
+
+template<typename... Args>
+template<size_t I>
+constexpr size_t static_parser<Args...>::positional_ordinal()
+{
+    if constexpr (I == 0)
+        return 0;
+    else
+        return positional_ordinal<I - 1>() + (arg_type<I - 1>::kind == keyword_index::positional_kind ? 1 : 0);
+}
+
+template<typename... Args>
+constexpr size_t static_parser<Args...>::positional_count()
+{
+    return ((Args::kind == keyword_index::positional_kind ? 1 : 0) + ... + 0);
+}
+
+template<typename... Args>
+constexpr size_t static_parser<Args...>::prefix_length(std::string_view prefix, std::string_view name, std::string_view arg)
+{
+    // dashes the name already starts with are not added again, as in verify_argument_key
+    size_t dashes = 0;
+    while (dashes < prefix.length() && dashes < name.length() && name[dashes] == prefix[dashes])
+        dashes++;
+    prefix.remove_prefix(dashes);
+    if (arg.substr(0, prefix.length()) != prefix)
+        return 0;
+    arg.remove_prefix(prefix.length());
+    if (arg.substr(0, name.length()) != name)
+        return 0;
+    return prefix.length() + name.length();
+}
+
+template<typename... Args>
+constexpr size_t static_parser<Args...>::option_length(const static_keyword& key, std::string_view arg)
+{
+    auto length = prefix_length("--", key.key, arg);
+    if (!key.abbreviation.empty())
+        length = std::max(length, prefix_length("-", key.abbreviation, arg));
+    return length;
+}
+
+template<typename... Args>
+void static_parser<Args...>::parse(int argc, char **args)
+{
+    auto status = try_parse(argc, args);
+    if (!status)
+        ARGCPP17_THROW(status.error);
+}
+
+template<typename... Args>
+parse_status static_parser<Args...>::try_parse(int argc, char **args)
+{
+    // skip first argument
+    return parse_tokens(&args[1], &args[1] + argc - 1);
+}
+
+template<typename... Args>
+void static_parser<Args...>::parse_vector(std::vector<std::string>& args)
+{
+    auto status = parse_tokens(args.begin(), args.end());
+    if (!status)
+        ARGCPP17_THROW(status.error);
+}
+
+template<typename... Args>
+template<typename It>
+parse_status static_parser<Args...>::parse_tokens(It begin, It end)
+{
+    auto sequence = std::index_sequence_for<Args...>{};
+    m_values = values_type();
+    m_parsed.fill(false);
+
+    auto fail = [](argcpp17_exception::argcpp17_error error, size_t index) { return parse_status{ false, error, index }; };
+    size_t index = 0;
+    size_t ordinal = 0;
+    size_t unknown = SIZE_MAX;
+    for (auto it = begin; it != end; ++it, ++index) {
+        std::string_view arg = *it;
+
+        size_t option = npos;
+        size_t length = 0;
+        // option names always start with a dash
+        if (!arg.empty() && arg.front() == '-')
+            find_option(arg, option, length, sequence);
+        if (option != npos) {
+            std::string_view value;
+            if (length == arg.length()) {
+                // value is the next token
+                if (++it == end)
+                    return fail(argcpp17_exception::err_missing_value, index);
+                ++index;
+                value = *it;
+            } else {
+                value = arg.substr(length);
+                if (value.front() == '=' || value.front() == ':')
+                    value.remove_prefix(1);
+            }
+            if (!update_value(option, value, sequence))
+                return fail(argcpp17_exception::err_invalid_value, index);
+            continue;
+        }
+
+        if (parse_flag(arg, sequence))
+            continue;
+        bool valid = true;
+        if (parse_positional(arg, ordinal, valid, sequence))
+            ordinal++;
+        else if (unknown == SIZE_MAX)
+            unknown = index;
+        if (!valid)
+            return fail(argcpp17_exception::err_invalid_value, index);
     }
-    {
-        auto it = find_option(key, m_positionals.begin(), m_positionals.end());
-        if (it != m_positionals.end())
-            return it->value<T>();
+
+    if (!check_mandatory(sequence))
+        return fail(argcpp17_exception::err_missing_mandatory, index);
+    if (unknown != SIZE_MAX)
+        return fail(argcpp17_exception::err_unknown_arguments, unknown);
+    else if (ordinal < positional_count())
+        return fail(argcpp17_exception::err_missing_positionals, index);
+    return parse_status();
+}
+
+template<typename... Args>
+template<size_t... I>
+void static_parser<Args...>::find_option(std::string_view arg, size_t& index, size_t& length, std::index_sequence<I...>) const
+{
+    // longest match wins, as in option_trie
+    auto check = [&](size_t i, keyword_index::kind kind, const static_keyword& key) {
+        if (kind != keyword_index::optional_kind && kind != keyword_index::mandatory_kind)
+            return;
+        auto l = option_length(key, arg);
+        if (l > length) {
+            index = i;
+            length = l;
+        }
+    };
+    (check(I, arg_type<I>::kind, arg_type<I>::key), ...);
+}
+
+template<typename... Args>
+template<size_t... I>
+bool static_parser<Args...>::parse_flag(std::string_view arg, std::index_sequence<I...>)
+{
+    auto check = [&](auto i) {
+        constexpr size_t index = decltype(i)::value;
+        if constexpr (arg_type<index>::kind == keyword_index::flag_kind) {
+            constexpr auto& key = arg_type<index>::key;
+            if (arg != key.key && (key.abbreviation.empty() || arg != key.abbreviation))
+                return false;
+            update_value<index>(arg);
+            return true;
+        } else
+            return false;
+    };
+    return (check(std::integral_constant<size_t, I>{}) || ...);
+}
+
+template<typename... Args>
+template<size_t... I>
+bool static_parser<Args...>::parse_positional(std::string_view arg, size_t ordinal, bool& valid, std::index_sequence<I...>)
+{
+    auto check = [&](auto i) {
+        constexpr size_t index = decltype(i)::value;
+        if constexpr (arg_type<index>::kind == keyword_index::positional_kind) {
+            if (positional_ordinal<index>() != ordinal)
+                return false;
+            valid = update_value<index>(arg);
+            return true;
+        } else
+            return false;
+    };
+    return (check(std::integral_constant<size_t, I>{}) || ...);
+}
+
+template<typename... Args>
+template<size_t... I>
+bool static_parser<Args...>::update_value(size_t index, std::string_view value, std::index_sequence<I...>)
+{
+    bool valid = false;
+    (void) ((I == index ? (valid = update_value<I>(value), true) : false) || ...);
+    return valid;
+}
+
+template<typename... Args>
+template<size_t I>
+bool static_parser<Args...>::update_value(std::string_view value)
+{
+    using arg = arg_type<I>;
+    if constexpr (arg::kind == keyword_index::flag_kind)
+        std::get<I>(m_values) = true;
+    else {
+        typename arg::parsed_type parsed{};
+        if (!convert_value(value, parsed))
+            return false;
+        std::get<I>(m_values) = std::move(parsed);
     }
-    return std::nullopt;
+    m_parsed[I] = true;
+    return true;
 }
 
-bool parser::get_flag(const keyword& key)
+template<typename... Args>
+template<size_t... I>
+bool static_parser<Args...>::check_mandatory(std::index_sequence<I...>) const
 {
-    auto it = find_option(key, m_flags.begin(), m_flags.end());
-    if (it != m_flags.end())
-        return it->is_set();
-    return false;
+    return ((arg_type<I>::kind != keyword_index::mandatory_kind || m_parsed[I]) && ...);
 }
 
+
+// non-template implementations, see ARGCPP17_INLINE
+#if defined(ARGCPP17_HEADER_ONLY)
+#include "argcpp17_impl.h"
+#endif
+
 #endif
\ No newline at end of file
@@ -0,0 +1,2606 @@
+#ifndef _ARGCPP17_IMPL_H_
+#define _ARGCPP17_IMPL_H_
+
+// definitions of the non-template functions declared in argcpp17.h
+// included by argcpp17.h with ARGCPP17_HEADER_ONLY, otherwise compiled once by src/argcpp17.cpp
+
+#include "argcpp17.h"
+
+#include <iostream>
+#include <cstdio>
+#include <cctype>
+#include <thread>
+#include <atomic>
+#include <exception>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ARGCPP17_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+template<>
+ARGCPP17_INLINE std::string parse_value(const std::string& value)
+{
+    return value;
+}
+
+
+template<>
+ARGCPP17_INLINE std::string parse_value(std::string_view value)
+{
+    return std::string(value);
+}
+
+
+template<>
+ARGCPP17_INLINE std::string_view parse_value(std::string_view value)
+{
+    return value;
+}
+
+
+template<>
+ARGCPP17_INLINE std::optional<std::string> parse_value(const std::optional<std::string>& value)
+{
+   return value;
+}
+
+
+//value_converter implementations
+ARGCPP17_INLINE bool value_converter<bool>::convert(std::string_view value, bool& result)
+{
+    if (value == "1" || value == "true" || value == "yes" || value == "on")
+        result = true;
+    else if (value == "0" || value == "false" || value == "no" || value == "off")
+        result = false;
+    else
+        return false;
+    return true;
+}
+
+ARGCPP17_INLINE bool value_converter<char>::convert(std::string_view value, char& result)
+{
+    if (value.length() != 1)
+        return false;
+    result = value.front();
+    return true;
+}
+
+ARGCPP17_INLINE bool value_converter<byte_size>::convert(std::string_view value, byte_size& result)
+{
+    auto split = std::min(value.find_first_not_of("0123456789"), value.length());
+    auto unit = value.substr(split);
+    uint64_t count;
+    if (!value_converter<uint64_t>::convert(value.substr(0, split), count))
+        return false;
+
+    static const std::pair<std::string_view, uint64_t> units[] = {
+        { "", 1 }, { "B", 1 },
+        { "K", 1ull << 10 }, { "KiB", 1ull << 10 }, { "KB", 1000ull },
+        { "M", 1ull << 20 }, { "MiB", 1ull << 20 }, { "MB", 1000ull * 1000 },
+        { "G", 1ull << 30 }, { "GiB", 1ull << 30 }, { "GB", 1000ull * 1000 * 1000 },
+        { "T", 1ull << 40 }, { "TiB", 1ull << 40 }, { "TB", 1000ull * 1000 * 1000 * 1000 },
+    };
+    for (auto& [name, factor] : units)
+        if (name == unit) {
+            if (count > UINT64_MAX / factor)
+                return false;
+            result = byte_size(count * factor);
+            return true;
+        }
+    return false;
+}
+
+
+//argcpp17_exception implementations
+ARGCPP17_INLINE void argcpp17_abort(argcpp17_exception::argcpp17_error error)
+{
+    std::fputs(argcpp17_exception(error).what(), stderr);
+    std::fputc('\n', stderr);
+    std::abort();
+}
+
+ARGCPP17_INLINE argcpp17_exception::argcpp17_exception(argcpp17_error error) 
+    : m_error(error) 
+{};
+
+ARGCPP17_INLINE const char* argcpp17_exception::what() const noexcept
+{
+    switch (m_error) {
+        case err_duplicate_keyword:
+            return "keyword already used";
+        case err_unknown_arguments:
+            return "found unknown arguments";
+        case err_missing_positionals:
+            return "missing positional argumenzs";
+        case err_subcommand_not_found:
+            return "subcommand not found";
+        case err_missing_mandatory:
+            return "missing mandatory argument";
+        case err_missing_positional:
+            return "missing positional argument";
+        case err_missing_value:
+            return "missing argument value";
+        case err_invalid_value:
+            return "invalid argument value";
+        case err_response_file:
+            return "cannot read response file";
+        case err_response_file_depth:
+            return "response files nested too deep";
+        case err_positional_after_list:
+            return "positional argument added after positional list";
+        case err_unknown_keyword:
+            return "keyword not found";
+        case err_config_file:
+            return "config file could not be read";
+        case err_subcommand_deferred:
+            return "subcommand is not built yet";
+        case err_invalid_schema_image:
+            return "schema image is invalid or from another version";
+        case err_conflicting_arguments:
+            return "conflicting arguments";
+        case err_missing_requirement:
+            return "missing required argument";
+        default:
+            return "unknown error in argcpp17";
+    }
+}
+
+
+//keyword implementations
+ARGCPP17_INLINE keyword::keyword(std::string key, std::optional<std::string> abbreviation) 
+    : m_key(std::move(key))
+    , m_abbreviation(std::move(abbreviation))
+{}
+
+ARGCPP17_INLINE bool keyword::operator==(const keyword& rhs) const
+{
+    return m_key == rhs.m_key || 
+           m_key == rhs.m_abbreviation ||
+           m_abbreviation == rhs.m_key ||
+           (m_abbreviation.has_value() && m_abbreviation == rhs.m_abbreviation);
+}
+
+ARGCPP17_INLINE bool keyword::operator==(const std::string& rhs) const
+{
+    return m_key == rhs || 
+           m_abbreviation == rhs;
+}
+
+ARGCPP17_INLINE bool keyword::matches(std::string_view name) const
+{
+    return m_key == name ||
+           (m_abbreviation.has_value() && m_abbreviation.value() == name);
+}
+
+// ostream operator for keyword
+ARGCPP17_INLINE std::ostream& operator<<(std::ostream& os, const keyword& key) {
+    os << key.get_key();
+    auto abbr = key.get_abbreviation();
+    if (abbr.has_value())
+        os << ", " << abbr.value();
+    return os;
+}
+
+
+//argument_value implementations
+ARGCPP17_INLINE argument_value::argument_value(const argument_value& rhs)
+{
+    *this = rhs;
+}
+
+ARGCPP17_INLINE argument_value& argument_value::operator=(const argument_value& rhs)
+{
+    if (this == &rhs)
+        return *this;
+    m_has_value = rhs.m_has_value;
+    m_owned = rhs.m_owned;
+    if (m_owned) {
+        m_storage = rhs.m_storage;
+        m_view = m_storage;
+    } else {
+        m_storage.clear();
+        m_view = rhs.m_view;
+    }
+    return *this;
+}
+
+ARGCPP17_INLINE argument_value::argument_value(argument_value&& rhs) noexcept
+{
+    *this = std::move(rhs);
+}
+
+ARGCPP17_INLINE argument_value& argument_value::operator=(argument_value&& rhs) noexcept
+{
+    if (this == &rhs)
+        return *this;
+    m_has_value = rhs.m_has_value;
+    m_owned = rhs.m_owned;
+    // short strings are moved by copying their characters, so the view is taken again
+    m_storage = std::move(rhs.m_storage);
+    m_view = m_owned ? std::string_view(m_storage) : rhs.m_view;
+    rhs.clear();
+    return *this;
+}
+
+ARGCPP17_INLINE void argument_value::assign(std::string_view value)
+{
+    ARGCPP17_STATS(auto capacity = m_storage.capacity();)
+    m_storage = value;
+    ARGCPP17_STATS(counting_resource::record_growth(capacity, m_storage.capacity(), sizeof(char));)
+    m_view = m_storage;
+    m_has_value = true;
+    m_owned = true;
+}
+
+ARGCPP17_INLINE void argument_value::assign_view(std::string_view value)
+{
+    m_view = value;
+    m_has_value = true;
+    m_owned = false;
+}
+
+ARGCPP17_INLINE void argument_value::clear()
+{
+    m_storage.clear();
+    m_view = std::string_view();
+    m_has_value = false;
+    m_owned = false;
+}
+
+
+
+//value_list_storage implementations
+ARGCPP17_INLINE value_list_storage::value_list_storage(const value_list_storage& rhs)
+{
+    *this = rhs;
+}
+
+ARGCPP17_INLINE value_list_storage& value_list_storage::operator=(const value_list_storage& rhs)
+{
+    if (this == &rhs)
+        return *this;
+    m_storage = rhs.m_storage;
+    m_views = rhs.m_views;
+    m_owned = rhs.m_owned;
+    if (m_owned)
+        rebase();
+    return *this;
+}
+
+ARGCPP17_INLINE value_list_storage::value_list_storage(value_list_storage&& rhs) noexcept
+{
+    *this = std::move(rhs);
+}
+
+ARGCPP17_INLINE value_list_storage& value_list_storage::operator=(value_list_storage&& rhs) noexcept
+{
+    if (this == &rhs)
+        return *this;
+    m_storage = std::move(rhs.m_storage);
+    m_views = std::move(rhs.m_views);
+    m_owned = rhs.m_owned;
+    // short strings are moved by copying their characters, so the views are taken again
+    if (m_owned)
+        rebase();
+    rhs.clear();
+    return *this;
+}
+
+ARGCPP17_INLINE void value_list_storage::assign(value_list values)
+{
+    size_t length = 0;
+    for (auto value : values)
+        length += value.size();
+    ARGCPP17_STATS(
+        auto capacity = m_storage.capacity();
+        auto view_capacity = m_views.capacity();
+    )
+    m_storage.clear();
+    m_storage.reserve(length);
+    for (auto value : values)
+        m_storage.append(value.data(), value.size());
+    m_views.assign(values.begin(), values.end());
+    ARGCPP17_STATS(
+        counting_resource::record_growth(capacity, m_storage.capacity(), sizeof(char));
+        counting_resource::record_growth(view_capacity, m_views.capacity(), sizeof(std::string_view));
+    )
+    m_owned = true;
+    rebase();
+}
+
+ARGCPP17_INLINE void value_list_storage::assign_views(value_list values)
+{
+    m_storage.clear();
+    m_views.assign(values.begin(), values.end());
+    m_owned = false;
+}
+
+ARGCPP17_INLINE void value_list_storage::clear()
+{
+    m_storage.clear();
+    m_views.clear();
+    m_owned = false;
+}
+
+ARGCPP17_INLINE void value_list_storage::rebase()
+{
+    size_t offset = 0;
+    for (auto& view : m_views) {
+        view = std::string_view(m_storage.data() + offset, view.size());
+        offset += view.size();
+    }
+}
+
+
+//argument_cache implementations
+ARGCPP17_INLINE argument_cache::argument_cache(const argument_cache& rhs)
+{
+    *this = rhs;
+}
+
+ARGCPP17_INLINE argument_cache& argument_cache::operator=(const argument_cache& rhs)
+{
+    if (this == &rhs)
+        return *this;
+    m_storage = rhs.m_storage;
+    m_owned = rhs.m_owned;
+    if (m_owned)
+        m_value = std::string_view(m_storage);
+    else
+        m_value = rhs.m_value;
+    return *this;
+}
+
+ARGCPP17_INLINE argument_cache::argument_cache(argument_cache&& rhs) noexcept
+{
+    *this = std::move(rhs);
+}
+
+ARGCPP17_INLINE argument_cache& argument_cache::operator=(argument_cache&& rhs) noexcept
+{
+    if (this == &rhs)
+        return *this;
+    // short strings are moved by copying their characters, so the view is taken again
+    m_storage = std::move(rhs.m_storage);
+    m_owned = rhs.m_owned;
+    if (m_owned)
+        m_value = std::string_view(m_storage);
+    else
+        m_value = std::move(rhs.m_value);
+    rhs.reset();
+    return *this;
+}
+
+ARGCPP17_INLINE void argument_cache::assign(const std::any& value)
+{
+    m_value = value;
+    m_storage.clear();
+    m_owned = false;
+}
+
+ARGCPP17_INLINE void argument_cache::assign_copy(const std::any& value)
+{
+    auto view = value.has_value() ? std::any_cast<std::string_view>(&value) : nullptr;
+    if (!view) {
+        assign(value);
+        return;
+    }
+    ARGCPP17_STATS(auto capacity = m_storage.capacity();)
+    m_storage.assign(view->data(), view->size());
+    ARGCPP17_STATS(counting_resource::record_growth(capacity, m_storage.capacity(), sizeof(char));)
+    m_value = std::string_view(m_storage);
+    m_owned = true;
+}
+
+ARGCPP17_INLINE void argument_cache::reset()
+{
+    m_value.reset();
+    m_storage.clear();
+    m_owned = false;
+}
+
+//argument implementations
+ARGCPP17_INLINE argument::argument(keyword key, std::string description)
+    : m_key(std::move(key))
+    , m_description(std::move(description))
+    , m_parsed(false)
+{};
+
+
+ARGCPP17_INLINE bool argument::update_cache(std::string_view value)
+{
+    if (!m_converter)
+        return true;
+    return m_converter(value, m_cache.get());
+}
+
+ARGCPP17_INLINE bool argument::operator==(const keyword& rhs) const
+{
+    return m_key == rhs;
+}
+
+ARGCPP17_INLINE bool argument::operator==(const std::string& rhs) const
+{
+    return m_key == rhs;
+}
+
+// ostream operator for argument
+ARGCPP17_INLINE std::ostream& operator<<(std::ostream& os, const argument& command) {
+    os << command.get_key() << "    " << command.get_description();
+    return os;
+}
+
+
+//subcommand implementations
+template<>
+ARGCPP17_INLINE subcommand<parser>::subcommand(keyword key, std::string description)
+    : argument(std::move(key), std::move(description))
+    , m_parser(std::make_unique<parser>())
+{};
+
+template<>
+ARGCPP17_INLINE subcommand<parser>::subcommand(keyword key, std::string description, std::function<void(parser&)> builder, std::function<int(parser&)> handler)
+    : argument(std::move(key), std::move(description))
+    , m_builder(std::move(builder))
+    , m_handler(std::move(handler))
+{}
+
+// copies are deep, each subcommand owns its parser, deferred ones stay deferred
+template<>
+ARGCPP17_INLINE subcommand<parser>::subcommand(const subcommand<parser>& rhs) 
+    : argument(rhs)
+    , m_parser(rhs.m_parser ? std::make_unique<parser>(*rhs.m_parser) : nullptr)
+    , m_builder(rhs.m_builder)
+    , m_handler(rhs.m_handler)
+{}
+
+template<>
+ARGCPP17_INLINE subcommand<parser>& subcommand<parser>::operator=(const subcommand<parser>& rhs)
+{
+    if (this == &rhs)
+        return *this;
+    argument::operator=(rhs);
+    m_parser = rhs.m_parser ? std::make_unique<parser>(*rhs.m_parser) : nullptr;
+    m_builder = rhs.m_builder;
+    m_handler = rhs.m_handler;
+    return *this;
+}
+
+template<>
+ARGCPP17_INLINE parser& subcommand<parser>::get_parser() 
+{ 
+    if (!m_parser) {
+        m_parser = std::make_unique<parser>();
+        if (m_builder)
+            m_builder(*m_parser);
+    }
+    return *m_parser; 
+}
+
+
+//flag implementations
+ARGCPP17_INLINE flag::flag(keyword key, std::string description)
+    : argument(std::move(key), std::move(description))
+{};
+
+ARGCPP17_INLINE keyword verify_argument_key(const keyword& key)
+{
+    keyword updated_key = key;
+    // only the missing dashes are added, so -output becomes --output
+    if (updated_key.get_key().substr(0, 2) != "--")
+        updated_key = keyword((updated_key.get_key().substr(0, 1) == "-" ? "-" : "--") + updated_key.get_key(), updated_key.get_abbreviation());
+    if (updated_key.get_abbreviation().has_value() && (updated_key.get_abbreviation().value().substr(0, 1) != "-"))
+        updated_key = keyword(updated_key.get_key(), "-" + updated_key.get_abbreviation().value());
+    return updated_key;    
+}
+
+
+//optional_argument implementations
+ARGCPP17_INLINE optional_argument::optional_argument(keyword key, std::string description)
+    : argument(std::move(key), std::move(description))
+{
+};
+
+
+//mandatory_argument implementations
+ARGCPP17_INLINE mandatory_argument::mandatory_argument(keyword key, std::string description)
+    : argument(std::move(key), std::move(description))
+{
+};
+
+
+//positional_argument implementations
+ARGCPP17_INLINE positional_argument::positional_argument(std::string name, std::string description)
+    : argument(std::move(name), std::move(description))
+{};
+
+
+//keyword_index implementations
+ARGCPP17_INLINE keyword_index::keyword_index(std::pmr::memory_resource* resource)
+    : m_slots(resource)
+    , m_names(resource)
+{}
+
+ARGCPP17_INLINE keyword_index::keyword_index(const keyword_index& rhs, std::pmr::memory_resource* resource)
+    : m_slots(rhs.m_slots, resource)
+    , m_names(rhs.m_names, resource)
+    , m_size(rhs.m_size)
+{}
+
+ARGCPP17_INLINE uint64_t keyword_index::hash(std::string_view name)
+{
+    // FNV-1a
+    uint64_t h = 14695981039346656037ull;
+    for (auto c : name) {
+        h ^= (uint8_t) c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+ARGCPP17_INLINE const keyword_index::slot* keyword_index::find_slot(std::string_view name, uint64_t hash) const
+{
+    if (m_slots.empty())
+        return nullptr;
+    size_t mask = m_slots.size() - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        auto& s = m_slots[i];
+        if (s.value.type == none)
+            return &s;
+        if (s.hash == hash && this->name(s) == name)
+            return &s;
+    }
+}
+
+ARGCPP17_INLINE void keyword_index::grow()
+{
+    // assign keeps the memory resource of the table
+    auto old_slots = std::move(m_slots);
+    m_slots.assign(old_slots.empty() ? 16 : old_slots.size() * 2, slot{ 0, 0, 0, { none, 0 } });
+    for (auto& s : old_slots)
+        if (s.value.type != none)
+            *const_cast<slot*>(find_slot(name(s), s.hash)) = s;
+}
+
+ARGCPP17_INLINE bool keyword_index::insert(std::string_view name, kind type, uint32_t index)
+{
+    // keep load factor below 1/2
+    if ((m_size + 1) * 2 > m_slots.size())
+        grow();
+    auto h = hash(name);
+    auto s = const_cast<slot*>(find_slot(name, h));
+    if (s->value.type != none)
+        return false;
+    *s = slot{ h, (uint32_t) m_names.size(), (uint32_t) name.length(), { type, index } };
+    m_names.append(name);
+    m_size++;
+    return true;
+}
+
+ARGCPP17_INLINE bool keyword_index::insert_keyword(const keyword& key, kind type, uint32_t index)
+{
+    if (contains(key))
+        return false;
+    insert(key.get_key(), type, index);
+    auto& abbr = key.get_abbreviation();
+    if (abbr.has_value() && abbr.value() != key.get_key())
+        insert(abbr.value(), type, index);
+    return true;
+}
+
+ARGCPP17_INLINE const keyword_index::entry* keyword_index::find(std::string_view name, uint8_t kinds) const
+{
+    auto s = find_slot(name, hash(name));
+    if (!s || s->value.type == none || !(s->value.type & kinds))
+        return nullptr;
+    return &s->value;
+}
+
+ARGCPP17_INLINE const keyword_index::entry* keyword_index::find_keyword(const keyword& key, uint8_t kinds) const
+{
+    auto e = find(key.get_key(), kinds);
+    if (!e && key.get_abbreviation().has_value())
+        e = find(key.get_abbreviation().value(), kinds);
+    return e;
+}
+
+ARGCPP17_INLINE bool keyword_index::contains(const keyword& key) const
+{
+    return find_keyword(key) != nullptr;
+}
+
+ARGCPP17_INLINE void keyword_index::clear()
+{
+    m_slots.clear();
+    m_names.clear();
+    m_size = 0;
+}
+
+ARGCPP17_INLINE void keyword_index::save(schema_writer& writer) const
+{
+    // slots keep their hashes, so loading does not hash or probe again
+    writer.write(static_cast<uint32_t>(m_size));
+    writer.write(m_slots);
+    writer.write(m_names);
+}
+
+ARGCPP17_INLINE void keyword_index::load(schema_reader& reader)
+{
+    uint32_t size = 0;
+    reader.read(size);
+    reader.read(m_slots);
+    reader.read(m_names);
+    m_size = size;
+
+    // probing masks the hash and stops at a free slot, so the table needs a power of two size and a free slot
+    size_t used = 0;
+    for (auto& s : m_slots) {
+        if (s.value.type == none)
+            continue;
+        if (s.offset > m_names.size() || s.length > m_names.size() - s.offset)
+            ARGCPP17_THROW(argcpp17_exception::err_invalid_schema_image);
+        used++;
+    }
+    if ((m_slots.size() & (m_slots.size() - 1)) || used != m_size || (!m_slots.empty() && used == m_slots.size()))
+        ARGCPP17_THROW(argcpp17_exception::err_invalid_schema_image);
+}
+
+
+//option_trie implementations
+ARGCPP17_INLINE option_trie::option_trie(std::pmr::memory_resource* resource)
+    : m_nodes(1, node{ npos, npos, 0, false, { keyword_index::none, 0 } }, resource)
+{}
+
+ARGCPP17_INLINE option_trie::option_trie(const option_trie& rhs, std::pmr::memory_resource* resource)
+    : m_nodes(rhs.m_nodes, resource)
+    , m_size(rhs.m_size)
+{}
+
+ARGCPP17_INLINE uint32_t option_trie::find_child(uint32_t parent, char c) const
+{
+    for (auto n = m_nodes[parent].child; n != npos; n = m_nodes[n].sibling)
+        if (m_nodes[n].c == c)
+            return n;
+    return npos;
+}
+
+ARGCPP17_INLINE bool option_trie::insert(std::string_view name, keyword_index::entry value)
+{
+    uint32_t n = 0;
+    for (auto c : name) {
+        auto next = find_child(n, c);
+        if (next == npos) {
+            next = (uint32_t) m_nodes.size();
+            m_nodes.push_back(node{ npos, m_nodes[n].child, c, false, { keyword_index::none, 0 } });
+            m_nodes[n].child = next;
+        }
+        n = next;
+    }
+    if (m_nodes[n].terminal)
+        return false;
+    m_nodes[n].terminal = true;
+    m_nodes[n].value = value;
+    m_size++;
+    return true;
+}
+
+ARGCPP17_INLINE bool option_trie::contains(std::string_view name) const
+{
+    size_t length = 0;
+    return longest_prefix(name, length) && length == name.length();
+}
+
+ARGCPP17_INLINE const keyword_index::entry* option_trie::longest_prefix(std::string_view arg, size_t& length) const
+{
+    const keyword_index::entry* result = nullptr;
+    uint32_t n = 0;
+    for (size_t i = 0; i < arg.length(); i++) {
+        n = find_child(n, arg[i]);
+        if (n == npos)
+            break;
+        if (m_nodes[n].terminal) {
+            result = &m_nodes[n].value;
+            length = i + 1;
+        }
+    }
+    return result;
+}
+
+ARGCPP17_INLINE std::vector<std::string> option_trie::ambiguous_prefixes() const
+{
+    std::vector<std::string> result;
+    std::vector<std::pair<uint32_t, std::string>> stack = { { 0, std::string() } };
+    while (!stack.empty()) {
+        auto [n, name] = stack.back();
+        stack.pop_back();
+        if (m_nodes[n].terminal && m_nodes[n].child != npos)
+            result.push_back(name);
+        for (auto child = m_nodes[n].child; child != npos; child = m_nodes[child].sibling)
+            stack.push_back({ child, name + m_nodes[child].c });
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+ARGCPP17_INLINE void option_trie::save(schema_writer& writer) const
+{
+    writer.write(static_cast<uint32_t>(m_size));
+    writer.write(m_nodes);
+}
+
+ARGCPP17_INLINE void option_trie::load(schema_reader& reader)
+{
+    uint32_t size = 0;
+    reader.read(size);
+    reader.read(m_nodes);
+    if (m_nodes.empty())
+        ARGCPP17_THROW(argcpp17_exception::err_invalid_schema_image);
+    m_size = size;
+
+    // every node but the root is referenced exactly once, so walks from the root end
+    std::vector<uint8_t> references(m_nodes.size());
+    auto reference = [&](uint32_t n) {
+        if (n == npos)
+            return true;
+        return n != 0 && n < m_nodes.size() && !references[n]++;
+    };
+    size_t terminals = 0;
+    for (auto& n : m_nodes) {
+        if (!reference(n.child) || !reference(n.sibling))
+            ARGCPP17_THROW(argcpp17_exception::err_invalid_schema_image);
+        terminals += n.terminal;
+    }
+    if (terminals != m_size || m_nodes[0].sibling != npos)
+        ARGCPP17_THROW(argcpp17_exception::err_invalid_schema_image);
+}
+
+
+//schema_reader implementations
+ARGCPP17_INLINE const char* schema_reader::take(size_t length)
+{
+    if (length > m_image.size())
+        ARGCPP17_THROW(argcpp17_exception::err_invalid_schema_image);
+    auto data = m_image.data();
+    m_image.remove_prefix(length);
+    return data;
+}
+
+
+//wide_command_line implementations
+ARGCPP17_INLINE void wide_command_line::assign(int argc, wchar_t **args)
+{
+    // reserving the worst case up front keeps the token views valid while appending
+    size_t units = 0;
+    for (int i = 1; i < argc; i++)
+        units += std::wcslen(args[i]);
+    m_buffer.clear();
+    m_buffer.reserve(units * (sizeof(wchar_t) == 2 ? 3 : 4));
+    m_tokens.clear();
+    for (int i = 1; i < argc; i++) {
+        std::wstring_view arg(args[i]);
+        begin_token();
+        for (size_t c = 0; c < arg.size();)
+            append_utf8(arg, c);
+        end_token();
+    }
+}
+
+ARGCPP17_INLINE void wide_command_line::assign(std::wstring_view command_line)
+{
+    m_buffer.clear();
+    m_buffer.reserve(command_line.size() * (sizeof(wchar_t) == 2 ? 3 : 4));
+    m_tokens.clear();
+
+    auto is_space = [](wchar_t c) { return c == L' ' || c == L'\t'; };
+    size_t i = 0;
+    size_t n = command_line.size();
+    // the program name ends at the next quote if it starts with one, there is no escaping in it
+    if (i < n && command_line[i] == L'"') {
+        for (i++; i < n && command_line[i] != L'"'; i++) {}
+        i++;
+    } else
+        for (; i < n && !is_space(command_line[i]); i++) {}
+    for (; i < n && is_space(command_line[i]); i++) {}
+    if (i >= n)
+        return;
+
+    // 2n backslashes and a quote are n backslashes and toggle quoting, 2n + 1 are n backslashes and a quote,
+    // other backslashes are literal, inside quotes every third consecutive quote is a literal quote
+    size_t quotes = 0;
+    size_t backslashes = 0;
+    begin_token();
+    while (i < n) {
+        auto c = command_line[i];
+        if (is_space(c) && !quotes) {
+            end_token();
+            for (; i < n && is_space(command_line[i]); i++) {}
+            if (i < n)
+                begin_token();
+            backslashes = 0;
+        } else if (c == L'\\') {
+            m_buffer.push_back('\\');
+            backslashes++;
+            i++;
+        } else if (c == L'"') {
+            m_buffer.resize(m_buffer.size() - backslashes / 2 - (backslashes & 1));
+            if (backslashes & 1)
+                m_buffer.push_back('"');
+            else
+                quotes++;
+            i++;
+            backslashes = 0;
+            for (; i < n && command_line[i] == L'"'; i++)
+                if (++quotes == 3) {
+                    m_buffer.push_back('"');
+                    quotes = 0;
+                }
+            if (quotes == 2)
+                quotes = 0;
+        } else {
+            append_utf8(command_line, i);
+            backslashes = 0;
+        }
+    }
+    if (m_token_start != std::string::npos)
+        end_token();
+}
+
+ARGCPP17_INLINE void wide_command_line::append_utf8(std::wstring_view text, size_t& i)
+{
+    uint32_t code_point = static_cast<uint32_t>(text[i++]);
+    if constexpr (sizeof(wchar_t) == 2) {
+        if (code_point >= 0xD800 && code_point < 0xDC00 && i < text.size() && text[i] >= 0xDC00 && text[i] < 0xE000)
+            code_point = 0x10000 + ((code_point - 0xD800) << 10) + (static_cast<uint32_t>(text[i++]) - 0xDC00);
+        else if (code_point >= 0xD800 && code_point < 0xE000)
+            code_point = 0xFFFD;
+    } else if (code_point > 0x10FFFF || (code_point >= 0xD800 && code_point < 0xE000))
+        code_point = 0xFFFD;
+
+    if (code_point < 0x80)
+        m_buffer.push_back(static_cast<char>(code_point));
+    else if (code_point < 0x800) {
+        m_buffer.push_back(static_cast<char>(0xC0 | code_point >> 6));
+        m_buffer.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else if (code_point < 0x10000) {
+        m_buffer.push_back(static_cast<char>(0xE0 | code_point >> 12));
+        m_buffer.push_back(static_cast<char>(0x80 | (code_point >> 6 & 0x3F)));
+        m_buffer.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else {
+        m_buffer.push_back(static_cast<char>(0xF0 | code_point >> 18));
+        m_buffer.push_back(static_cast<char>(0x80 | (code_point >> 12 & 0x3F)));
+        m_buffer.push_back(static_cast<char>(0x80 | (code_point >> 6 & 0x3F)));
+        m_buffer.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+}
+
+ARGCPP17_INLINE void wide_command_line::begin_token()
+{
+    m_token_start = m_buffer.size();
+}
+
+ARGCPP17_INLINE void wide_command_line::end_token()
+{
+    m_tokens.emplace_back(m_buffer.data() + m_token_start, m_buffer.size() - m_token_start);
+    m_token_start = std::string::npos;
+}
+
+
+//response_file implementations
+ARGCPP17_INLINE response_file::~response_file()
+{
+    close();
+}
+
+
+ARGCPP17_INLINE bool response_file::open(const std::string& path)
+{
+    close();
+#if defined(ARGCPP17_HAS_MMAP)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+    m_size = static_cast<size_t>(info.st_size);
+    if (m_size) {
+        void* data = ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            ::close(fd);
+            m_size = 0;
+            return false;
+        }
+        m_data = static_cast<char*>(data);
+        m_mapped = true;
+    }
+    // the mapping stays valid after closing the descriptor
+    ::close(fd);
+    return true;
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    m_buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+    return true;
+#endif
+}
+
+ARGCPP17_INLINE void response_file::close()
+{
+#if defined(ARGCPP17_HAS_MMAP)
+    if (m_mapped)
+        ::munmap(m_data, m_size);
+#endif
+    m_buffer.clear();
+    m_data = nullptr;
+    m_size = 0;
+    m_mapped = false;
+}
+
+
+//parse_statistics implementations
+ARGCPP17_INLINE void parse_statistics::clear()
+{
+    subcommand_time = options_time = flags_time = positionals_time = std::chrono::nanoseconds(0);
+    tokens = 0;
+    allocations = 0;
+    allocated_bytes = 0;
+    conversions = 0;
+    subcommand_path.clear();
+}
+
+
+#if defined(ARGCPP17_ENABLE_STATS)
+//counting_resource implementations
+ARGCPP17_INLINE counting_resource::counting_resource(std::pmr::memory_resource* upstream)
+    : m_upstream(upstream)
+{}
+
+ARGCPP17_INLINE counting_resource::counters& counting_resource::thread_counters()
+{
+    // per thread, so parses on other threads don't show up in the statistics
+    thread_local counters current;
+    return current;
+}
+
+ARGCPP17_INLINE void counting_resource::record_growth(size_t before, size_t after, size_t element_size)
+{
+    if (after <= before)
+        return;
+    auto& current = thread_counters();
+    current.allocations++;
+    current.bytes += after * element_size;
+}
+
+ARGCPP17_INLINE void* counting_resource::do_allocate(size_t bytes, size_t alignment)
+{
+    auto& current = thread_counters();
+    current.allocations++;
+    current.bytes += bytes;
+    return m_upstream->allocate(bytes, alignment);
+}
+
+ARGCPP17_INLINE void counting_resource::do_deallocate(void* ptr, size_t bytes, size_t alignment)
+{
+    m_upstream->deallocate(ptr, bytes, alignment);
+}
+
+ARGCPP17_INLINE bool counting_resource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+
+ARGCPP17_INLINE counting_resource* statistics_resource()
+{
+    static counting_resource resource(std::pmr::new_delete_resource());
+    return &resource;
+}
+
+
+//phase_timer implementations
+ARGCPP17_INLINE phase_timer::phase_timer(parse_statistics* statistics)
+    : m_statistics(statistics)
+{
+    if (m_statistics)
+        m_start = std::chrono::steady_clock::now();
+}
+
+ARGCPP17_INLINE void phase_timer::stop(std::chrono::nanoseconds parse_statistics::* phase)
+{
+    if (m_statistics)
+        m_statistics->*phase += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start);
+}
+#endif
+
+
+//parse_result implementations
+ARGCPP17_INLINE parse_result::parse_result(const allocator_type& allocator)
+    : m_parsed(allocator)
+    , m_values(allocator)
+    , m_cache(allocator)
+    , m_repeated(allocator)
+    , m_repeated_cache(allocator)
+    , m_lists(allocator)
+    , m_list_cache(allocator)
+    , m_list_offsets(allocator)
+    , m_subcommand_result(allocator)
+{}
+
+#if defined(ARGCPP17_ENABLE_STATS)
+ARGCPP17_INLINE parse_result::parse_result()
+    : parse_result(allocator_type(statistics_resource()))
+{}
+#endif
+
+ARGCPP17_INLINE parse_result::parse_result(const parse_result& rhs)
+    : parse_result()
+{
+    *this = rhs;
+}
+
+ARGCPP17_INLINE parse_result::parse_result(const parse_result& rhs, const allocator_type& allocator)
+    : parse_result(allocator)
+{
+    *this = rhs;
+}
+
+ARGCPP17_INLINE parse_result& parse_result::operator=(const parse_result& rhs)
+{
+    if (this == &rhs)
+        return *this;
+    m_schema = rhs.m_schema;
+    m_parsed = rhs.m_parsed;
+    m_values = rhs.m_values;
+    m_cache = rhs.m_cache;
+    m_repeated = rhs.m_repeated;
+    m_repeated_cache = rhs.m_repeated_cache;
+    m_lists = rhs.m_lists;
+    m_list_cache = rhs.m_list_cache;
+    m_list_offsets = rhs.m_list_offsets;
+    m_subcommand = rhs.m_subcommand;
+    // assignment keeps the memory resource of this result
+    m_subcommand_result = rhs.m_subcommand_result;
+    m_error = rhs.m_error;
+    m_error_code = rhs.m_error_code;
+    m_error_index = rhs.m_error_index;
+    return *this;
+}
+
+ARGCPP17_INLINE void parse_result::prepare(const prepared_parser& schema)
+{
+    // assign and resize keep the capacity of the buffers
+    m_schema = &schema;
+    m_parsed.assign(schema.slots(), 0);
+    m_values.assign(schema.slots(), std::string_view());
+    m_cache.resize(schema.slots());
+    for (auto& cache : m_cache)
+        cache.reset();
+    m_repeated.clear();
+    m_repeated_cache.clear();
+    m_lists.clear();
+    m_list_cache.clear();
+    m_list_offsets.clear();
+    m_subcommand = npos;
+    m_error = err_none;
+    m_error_code = argcpp17_exception::err_unknown;
+    m_error_index = 0;
+}
+
+ARGCPP17_INLINE void parse_result::clear()
+{
+    if (m_schema)
+        prepare(*m_schema);
+}
+
+ARGCPP17_INLINE bool parse_result::fail(argcpp17_exception::argcpp17_error error, size_t index)
+{
+    m_error = err_set;
+    m_error_code = error;
+    m_error_index = index;
+    return false;
+}
+
+ARGCPP17_INLINE void parse_result::collect_lists()
+{
+    if (m_repeated.empty())
+        return;
+
+    // counting sort by slot keeps command line order within a slot and needs no allocation on reuse
+    m_list_offsets.assign(m_parsed.size() + 1, 0);
+    for (auto& value : m_repeated)
+        m_list_offsets[value.first + 1]++;
+    for (size_t i = 1; i < m_list_offsets.size(); i++)
+        m_list_offsets[i] += m_list_offsets[i - 1];
+    m_lists.resize(m_repeated.size());
+    m_list_cache.resize(m_repeated.size());
+    for (size_t i = 0; i < m_repeated.size(); i++) {
+        auto position = m_list_offsets[m_repeated[i].first]++;
+        m_lists[position] = m_repeated[i].second;
+        m_list_cache[position] = std::move(m_repeated_cache[i]);
+    }
+    // offsets were advanced to the end of each slot, shift them back to the start
+    for (size_t i = m_list_offsets.size() - 1; i > 0; i--)
+        m_list_offsets[i] = m_list_offsets[i - 1];
+    m_list_offsets[0] = 0;
+    // single valued access returns the last occurrence
+    for (size_t slot = 0; slot < m_parsed.size(); slot++)
+        if (m_list_offsets[slot] != m_list_offsets[slot + 1])
+            m_cache[slot] = m_list_cache[m_list_offsets[slot + 1] - 1];
+}
+
+ARGCPP17_INLINE parse_result& parse_result::subcommand_result(size_t index)
+{
+    // constructed with the allocator of this result
+    if (m_subcommand_result.empty())
+        m_subcommand_result.emplace_back();
+    m_subcommand = index;
+    return m_subcommand_result.front();
+}
+
+ARGCPP17_INLINE size_t parse_result::find_value_slot(const keyword& key) const
+{
+    if (!m_schema)
+        return npos;
+    auto entry = m_schema->m_index.find_keyword(key, keyword_index::optional_kind | keyword_index::mandatory_kind);
+    if (!entry)
+        entry = m_schema->m_positional_index.find_keyword(key);
+    return entry ? m_schema->slot(*entry) : npos;
+}
+
+ARGCPP17_INLINE bool parse_result::get_flag(const keyword& key) const
+{
+    if (!m_schema)
+        return false;
+    auto entry = m_schema->m_index.find_keyword(key, keyword_index::flag_kind);
+    return entry && m_parsed[entry->index];
+}
+
+
+ARGCPP17_INLINE value_list parse_result::get_values(const keyword& key) const
+{
+    return slot_values(find_value_slot(key));
+}
+
+ARGCPP17_INLINE bool parse_result::get(const flag_handle& handle) const
+{
+    return handle.m_parser && m_schema && handle.m_index < m_schema->flags() && m_parsed[handle.m_index];
+}
+
+ARGCPP17_INLINE value_list parse_result::slot_values(size_t slot) const
+{
+    if (slot == npos || slot + 1 >= m_list_offsets.size())
+        return value_list();
+    return value_list(m_lists.data() + m_list_offsets[slot], m_lists.data() + m_list_offsets[slot + 1]);
+}
+
+ARGCPP17_INLINE const std::any* parse_result::slot_cache(size_t slot) const
+{
+    if (slot == npos || slot + 1 >= m_list_offsets.size())
+        return nullptr;
+    return m_list_cache.data() + m_list_offsets[slot];
+}
+
+ARGCPP17_INLINE const parse_result* parse_result::get_subcommand(const keyword& key) const
+{
+    if (!m_schema)
+        return nullptr;
+    auto entry = m_schema->m_index.find_keyword(key, keyword_index::subcommand_kind);
+    if (!entry || entry->index != m_subcommand)
+        return nullptr;
+    return &m_subcommand_result.front();
+}
+
+
+//batch_result implementations
+ARGCPP17_INLINE size_t batch_result::failures() const
+{
+    return static_cast<size_t>(std::count(ok.begin(), ok.end(), 0));
+}
+
+
+ARGCPP17_INLINE void batch_result::resize(size_t count)
+{
+    results.resize(count);
+    ok.resize(count);
+    errors.resize(count);
+    error_indices.resize(count);
+}
+
+
+//prepared_parser implementations
+ARGCPP17_INLINE prepared_parser::prepared_parser(std::pmr::memory_resource* resource)
+    : m_index(resource)
+    , m_positional_index(resource)
+    , m_option_trie(resource)
+    , m_subcommands(resource)
+    , m_converters(resource)
+    , m_value_types(resource)
+    , m_repeated(resource)
+    , m_completers(resource)
+    , m_candidates(resource)
+    , m_candidate_names(resource)
+    , m_fallbacks(resource)
+    , m_fallback_values(resource)
+    , m_descriptions(resource)
+    , m_description_offsets(resource)
+    , m_conflict_offsets(resource)
+    , m_conflicts(resource)
+    , m_requirements(resource)
+    , m_numbers(resource)
+    , m_ranges(resource)
+    , m_choice_offsets(resource)
+    , m_choices(resource)
+    , m_choice_names(resource)
+    , m_deferred(true)
+{}
+
+ARGCPP17_INLINE prepared_parser::prepared_parser(const parser& source, std::pmr::memory_resource* resource)
+    : m_index(source.m_index, resource)
+    , m_positional_index(source.m_positional_index, resource)
+    , m_option_trie(source.m_option_trie, resource)
+    , m_subcommands(resource)
+    , m_converters(resource)
+    , m_value_types(resource)
+    , m_repeated(resource)
+    , m_completers(resource)
+    , m_candidates(resource)
+    , m_candidate_names(resource)
+    , m_fallbacks(resource)
+    , m_fallback_values(resource)
+    , m_descriptions(resource)
+    , m_description_offsets(resource)
+    , m_conflict_offsets(resource)
+    , m_conflicts(resource)
+    , m_requirements(resource)
+    , m_numbers(resource)
+    , m_ranges(resource)
+    , m_choice_offsets(resource)
+    , m_choices(resource)
+    , m_choice_names(resource)
+    , m_flags(source.m_flags.size())
+    , m_mandatories(source.m_mandatories.size())
+    , m_optionals(source.m_optionals.size())
+    , m_positionals(source.m_positionals.size())
+    , m_source(&source)
+    , m_generation(source.m_generation)
+{
+    m_subcommands.reserve(source.m_subcommands.size());
+    for (auto& sub_command : source.m_subcommands)
+        if (sub_command.is_built())
+            m_subcommands.emplace_back(*sub_command.m_parser, resource);
+        else
+            m_subcommands.emplace_back(resource);
+
+    m_converters.assign(m_flags, nullptr);
+    m_value_types.assign(m_flags, 0);
+    m_repeated.assign(m_flags, 0);
+    m_completers.resize(m_flags);
+    auto add_slot = [this](const argument& arg) {
+        m_converters.push_back(arg.m_converter);
+        m_value_types.push_back(arg.m_value_type);
+        m_repeated.push_back(arg.m_repeated);
+        m_completers.push_back(arg.m_completer);
+    };
+    for (auto& arg : source.m_mandatories)
+        add_slot(arg);
+    for (auto& arg : source.m_optionals)
+        add_slot(arg);
+    for (auto& arg : source.m_positionals)
+        add_slot(arg);
+    m_positional_list = m_positionals && m_repeated.back();
+
+    m_description_offsets.reserve(slots() + m_subcommands.size() + 1);
+    auto add_description = [this](const argument& arg) {
+        m_description_offsets.push_back((uint32_t) m_descriptions.size());
+        m_descriptions.append(arg.get_description());
+    };
+    for (auto& arg : source.m_flags)
+        add_description(arg);
+    for (auto& arg : source.m_mandatories)
+        add_description(arg);
+    for (auto& arg : source.m_optionals)
+        add_description(arg);
+    for (auto& arg : source.m_positionals)
+        add_description(arg);
+    for (auto& sub_command : source.m_subcommands)
+        add_description(sub_command);
+    m_description_offsets.push_back((uint32_t) m_descriptions.size());
+
+    for (auto& arg : source.m_flags) {
+        add_flag_filter(arg.get_key().get_key());
+        if (arg.get_key().get_abbreviation().has_value())
+            add_flag_filter(arg.get_key().get_abbreviation().value());
+    }
+
+    // options win over flags with the same character, as they do for whole tokens
+    for (size_t i = 0; i < m_flags; i++)
+        add_short_option(source.m_flags[i].get_key().get_abbreviation(), { keyword_index::flag_kind, (uint32_t) i });
+    for (size_t i = 0; i < m_mandatories; i++)
+        add_short_option(source.m_mandatories[i].get_key().get_abbreviation(), { keyword_index::mandatory_kind, (uint32_t) i });
+    for (size_t i = 0; i < m_optionals; i++)
+        add_short_option(source.m_optionals[i].get_key().get_abbreviation(), { keyword_index::optional_kind, (uint32_t) i });
+
+    auto add_keyword = [this](const keyword& key, keyword_index::kind type) {
+        add_candidate(key.get_key(), type);
+        if (key.get_abbreviation().has_value())
+            add_candidate(key.get_abbreviation().value(), type);
+    };
+    for (auto& sub_command : source.m_subcommands)
+        add_keyword(sub_command.get_key(), keyword_index::subcommand_kind);
+    for (auto& arg : source.m_flags)
+        add_keyword(arg.get_key(), keyword_index::flag_kind);
+    for (auto& arg : source.m_mandatories)
+        add_keyword(verify_argument_key(arg.get_key()), keyword_index::mandatory_kind);
+    for (auto& arg : source.m_optionals)
+        add_keyword(verify_argument_key(arg.get_key()), keyword_index::optional_kind);
+    std::sort(m_candidates.begin(), m_candidates.end(), [this](const candidate& lhs, const candidate& rhs) {
+        return candidate_name(lhs) < candidate_name(rhs);
+    });
+
+    auto add_fallback = [this, &source](const argument& arg, size_t slot) {
+        // the environment is read per binding, so changes up to preparing are seen
+        std::optional<std::string_view> value;
+        const char* variable = arg.m_environment.empty() ? nullptr : std::getenv(arg.m_environment.c_str());
+        if (variable)
+            value = variable;
+        if (!value && !arg.m_config_key.empty()) {
+            auto it = source.m_config.find(arg.m_config_key);
+            if (it != source.m_config.end())
+                value = it->second;
+        }
+        if (!value)
+            return;
+        m_fallbacks.push_back({ (uint32_t) slot, (uint32_t) m_fallback_values.size(), (uint32_t) value->length() });
+        m_fallback_values.append(*value);
+    };
+    for (size_t i = 0; i < m_mandatories; i++)
+        add_fallback(source.m_mandatories[i], mandatory_slot(i));
+    for (size_t i = 0; i < m_optionals; i++)
+        add_fallback(source.m_optionals[i], optional_slot(i));
+
+    // conflicts are symmetric, counted per slot first and then filled in place
+    if (!source.m_conflicts.empty()) {
+        m_conflict_offsets.assign(slots() + 1, 0);
+        for (auto& conflict : source.m_conflicts) {
+            m_conflict_offsets[slot(conflict.first) + 1]++;
+            m_conflict_offsets[slot(conflict.second) + 1]++;
+        }
+        for (size_t i = 1; i < m_conflict_offsets.size(); i++)
+            m_conflict_offsets[i] += m_conflict_offsets[i - 1];
+        m_conflicts.resize(m_conflict_offsets.back());
+        std::pmr::vector<uint32_t> fill(m_conflict_offsets.begin(), m_conflict_offsets.end() - 1, resource);
+        for (auto& conflict : source.m_conflicts) {
+            auto first = (uint32_t) slot(conflict.first);
+            auto second = (uint32_t) slot(conflict.second);
+            m_conflicts[fill[first]++] = second;
+            m_conflicts[fill[second]++] = first;
+        }
+    }
+    for (auto& requirement : source.m_requirements)
+        m_requirements.push_back({ (uint32_t) slot(requirement.first), (uint32_t) slot(requirement.second) });
+
+    auto add_value_checks = [this](const argument& arg, size_t slot) {
+        if (arg.m_number) {
+            if (m_numbers.empty()) {
+                m_numbers.assign(slots(), nullptr);
+                m_ranges.assign(slots(), value_range{ 0, 0 });
+            }
+            m_numbers[slot] = arg.m_number;
+            m_ranges[slot] = { arg.m_min, arg.m_max };
+        }
+        if (!arg.m_choices.empty() && m_choice_offsets.empty())
+            m_choice_offsets.assign(slots() + 1, 0);
+        for (auto& name : arg.m_choices) {
+            m_choices.push_back({ (uint32_t) m_choice_names.size(), (uint32_t) name.length() });
+            m_choice_names.append(name);
+        }
+        if (!m_choice_offsets.empty())
+            m_choice_offsets[slot + 1] = (uint32_t) m_choices.size();
+    };
+    for (size_t i = 0; i < m_mandatories; i++)
+        add_value_checks(source.m_mandatories[i], mandatory_slot(i));
+    for (size_t i = 0; i < m_optionals; i++)
+        add_value_checks(source.m_optionals[i], optional_slot(i));
+    for (size_t i = 0; i < m_positionals; i++)
+        add_value_checks(source.m_positionals[i], positional_slot(i));
+    // slots before the first one with choices and flag slots have none
+    for (size_t i = 1; i < m_choice_offsets.size(); i++)
+        m_choice_offsets[i] = std::max(m_choice_offsets[i], m_choice_offsets[i - 1]);
+}
+
+ARGCPP17_INLINE void prepared_parser::add_flag_filter(std::string_view name)
+{
+    auto head = static_cast<unsigned char>(name.empty() ? 0 : name.front());
+    m_flag_lengths |= uint64_t(1) << std::min<size_t>(name.length(), 63);
+    m_flag_heads[head >> 6] |= uint64_t(1) << (head & 63);
+}
+
+ARGCPP17_INLINE void prepared_parser::add_short_option(const std::optional<std::string>& abbreviation, keyword_index::entry entry)
+{
+    // "v" and "-v" both stand for the character v
+    if (!abbreviation.has_value())
+        return;
+    std::string_view name = abbreviation.value();
+    if (name.length() == 2 && name.front() == '-')
+        name.remove_prefix(1);
+    if (name.length() == 1 && name.front() != '-')
+        m_short_options[static_cast<unsigned char>(name.front())] = entry;
+}
+
+ARGCPP17_INLINE void prepared_parser::run_parallel(size_t count, unsigned threads, const std::function<void(size_t, size_t)>& body)
+{
+    // chunks are handed out through a shared counter, so slow lines do not stall a fixed partition
+    constexpr size_t chunk_size = 256;
+    size_t chunks = (count + chunk_size - 1) / chunk_size;
+    if (!threads)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<size_t>(threads, chunks));
+
+    // the first exception stops handing out chunks and is rethrown on the calling thread
+    std::atomic<size_t> next = 0;
+    auto run = [&]() {
+        for (size_t chunk = next++; chunk < chunks; chunk = next++)
+            body(chunk * chunk_size, std::min(count, (chunk + 1) * chunk_size));
+    };
+#if defined(ARGCPP17_EXCEPTIONS)
+    std::exception_ptr error;
+    std::atomic_flag failed = ATOMIC_FLAG_INIT;
+    auto work = [&]() {
+        try {
+            run();
+        } catch (...) {
+            next = chunks;
+            if (!failed.test_and_set())
+                error = std::current_exception();
+        }
+    };
+#else
+    auto& work = run;
+#endif
+
+    // threads are started per call and joined before returning, also when starting one fails
+    struct joiner {
+        std::vector<std::thread> threads;
+        ~joiner() {
+            for (auto& thread : threads)
+                thread.join();
+        }
+    } pool;
+    pool.threads.reserve(threads);
+#if defined(ARGCPP17_EXCEPTIONS)
+    try {
+        for (unsigned i = 1; i < threads; i++)
+            pool.threads.emplace_back(work);
+    } catch (...) {
+        next = chunks;
+        throw;
+    }
+#else
+    for (unsigned i = 1; i < threads; i++)
+        pool.threads.emplace_back(work);
+#endif
+    work();
+    for (auto& thread : pool.threads)
+        thread.join();
+    pool.threads.clear();
+#if defined(ARGCPP17_EXCEPTIONS)
+    if (error)
+        std::rethrow_exception(error);
+#endif
+}
+
+
+ARGCPP17_INLINE bool prepared_parser::is_cluster(std::string_view arg) const
+{
+    // flag characters up to the end or up to an option character, which takes the rest as value
+    if (arg.length() < 2 || arg[0] != '-' || arg[1] == '-')
+        return false;
+    for (size_t i = 1; i < arg.length(); i++) {
+        auto type = m_short_options[static_cast<unsigned char>(arg[i])].type;
+        if (type == keyword_index::none)
+            return false;
+        if (type != keyword_index::flag_kind)
+            return true;
+    }
+    return true;
+}
+
+ARGCPP17_INLINE void prepared_parser::add_candidate(std::string_view name, keyword_index::kind type)
+{
+    m_candidates.push_back({ (uint32_t) m_candidate_names.size(), (uint32_t) name.length(), type });
+    m_candidate_names.append(name);
+}
+
+
+ARGCPP17_INLINE void prepared_parser::complete_word(std::string_view word, bool first, size_t positional, std::vector<std::string>& candidates) const
+{
+    // value attached to an option, e.g. --threads=
+    size_t length = 0;
+    auto entry = m_option_trie.longest_prefix(word, length);
+    if (entry && length < word.length() && (word[length] == '=' || word[length] == ':')) {
+        complete_value(slot(*entry), word.substr(0, length + 1), word.substr(length + 1), candidates);
+        return;
+    }
+
+    auto it = std::lower_bound(m_candidates.begin(), m_candidates.end(), word, [this](const candidate& c, std::string_view name) {
+        return candidate_name(c) < name;
+    });
+    for (; it != m_candidates.end() && candidate_name(*it).substr(0, word.length()) == word; ++it)
+        // subcommands are only valid as first token of their parser
+        if (first || it->type != keyword_index::subcommand_kind)
+            candidates.emplace_back(candidate_name(*it));
+
+    if (positional < m_positionals)
+        complete_value(positional_slot(positional), std::string_view(), word, candidates);
+}
+
+ARGCPP17_INLINE void prepared_parser::complete_value(size_t slot, std::string_view lead, std::string_view prefix, std::vector<std::string>& candidates) const
+{
+    if (!m_completers[slot])
+        return;
+    auto start = candidates.size();
+    m_completers[slot](prefix, candidates);
+    // drop values not matching the prefix and prepend the option of attached values
+    auto keep = candidates.begin() + start;
+    for (auto it = keep; it != candidates.end(); ++it) {
+        if (it->compare(0, prefix.length(), prefix) != 0)
+            continue;
+        if (!lead.empty())
+            it->insert(0, lead);
+        if (it != keep)
+            *keep = std::move(*it);
+        ++keep;
+    }
+    candidates.erase(keep, candidates.end());
+}
+
+ARGCPP17_INLINE std::string prepared_parser::save() const
+{
+    std::string image;
+    schema_writer writer(image);
+    writer.write(schema_image_magic);
+    writer.write(schema_image_layout());
+    save_tables(writer);
+    return image;
+}
+
+ARGCPP17_INLINE prepared_parser prepared_parser::load(std::string_view image, std::pmr::memory_resource* resource)
+{
+    schema_reader reader(image);
+    uint32_t magic = 0;
+    uint64_t layout = 0;
+    reader.read(magic);
+    reader.read(layout);
+    if (magic != schema_image_magic || layout != schema_image_layout())
+        ARGCPP17_THROW(argcpp17_exception::err_invalid_schema_image);
+
+    prepared_parser schema(resource);
+    schema.load_tables(reader);
+    if (!reader.at_end())
+        ARGCPP17_THROW(argcpp17_exception::err_invalid_schema_image);
+    return schema;
+}
+
+ARGCPP17_INLINE uint64_t prepared_parser::schema_image_layout()
+{
+    // images are native copies of the tables, so the format version and the element layout have to match
+    return (uint64_t) schema_image_version | (uint64_t) sizeof(keyword_index::entry) << 8 | (uint64_t) sizeof(candidate) << 16 |
+           (uint64_t) sizeof(long double) << 24 | (uint64_t) keyword_index::slot_size() << 32 |
+           (uint64_t) option_trie::node_size() << 40 | (uint64_t) sizeof(value_range) << 48;
+}
+
+ARGCPP17_INLINE void prepared_parser::save_tables(schema_writer& writer) const
+{
+    writer.write((uint8_t) m_deferred);
+    if (m_deferred)
+        return;
+
+    writer.write((uint32_t) m_flags);
+    writer.write((uint32_t) m_mandatories);
+    writer.write((uint32_t) m_optionals);
+    writer.write((uint32_t) m_positionals);
+    writer.write((uint8_t) m_positional_list);
+    m_index.save(writer);
+    m_positional_index.save(writer);
+    m_option_trie.save(writer);
+    writer.write(m_value_types);
+    writer.write(m_repeated);
+    writer.write(m_candidates);
+    writer.write(m_candidate_names);
+    writer.write(m_descriptions);
+    writer.write(m_description_offsets);
+    writer.write(m_flag_lengths);
+    writer.write(m_flag_heads);
+    writer.write(m_short_options);
+    writer.write(m_conflict_offsets);
+    writer.write(m_conflicts);
+    writer.write(m_requirements);
+    // range getters are restored from the value types like the converters
+    std::vector<uint8_t> bounded(m_numbers.size());
+    for (size_t i = 0; i < m_numbers.size(); i++)
+        bounded[i] = m_numbers[i] != nullptr;
+    writer.write(bounded);
+    writer.write(m_ranges);
+    writer.write(m_choice_offsets);
+    writer.write(m_choices);
+    writer.write(m_choice_names);
+
+    writer.write((uint32_t) m_subcommands.size());
+    for (auto& sub_command : m_subcommands)
+        sub_command.save_tables(writer);
+}
+
+ARGCPP17_INLINE void prepared_parser::load_tables(schema_reader& reader)
+{
+    uint8_t deferred = 0;
+    reader.read(deferred);
+    m_deferred = deferred;
+    if (m_deferred)
+        return;
+
+    uint32_t flags = 0, mandatories = 0, optionals = 0, positionals = 0;
+    uint8_t positional_list = 0;
+    reader.read(flags);
+    reader.read(mandatories);
+    reader.read(optionals);
+    reader.read(positionals);
+    reader.read(positional_list);
+    m_flags = flags;
+    m_mandatories = mandatories;
+    m_optionals = optionals;
+    m_positionals = positionals;
+    m_positional_list = positional_list;
+    m_index.load(reader);
+    m_positional_index.load(reader);
+    m_option_trie.load(reader);
+    reader.read(m_value_types);
+    reader.read(m_repeated);
+    reader.read(m_candidates);
+    reader.read(m_candidate_names);
+    reader.read(m_descriptions);
+    reader.read(m_description_offsets);
+    reader.read(m_flag_lengths);
+    reader.read(m_flag_heads);
+    reader.read(m_short_options);
+    reader.read(m_conflict_offsets);
+    reader.read(m_conflicts);
+    reader.read(m_requirements);
+    std::vector<uint8_t> bounded;
+    reader.read(bounded);
+    reader.read(m_ranges);
+    reader.read(m_choice_offsets);
+    reader.read(m_choices);
+    reader.read(m_choice_names);
+    if (m_value_types.size() != slots() || m_repeated.size() != slots() || m_description_offsets.empty())
+        ARGCPP17_THROW(argcpp17_exception::err_invalid_schema_image);
+
+    // converters are function pointers, so they are looked up by the saved type id
+    static constexpr auto converters = builtin_converters(std::make_index_sequence<std::tuple_size_v<builtin_value_types>>{});
+    m_converters.resize(slots());
+    for (size_t i = 0; i < slots(); i++) {
+        auto type = m_value_types[i];
+        m_converters[i] = type && type <= converters.size() ? converters[type - 1] : nullptr;
+    }
+    if ((!m_conflict_offsets.empty() && m_conflict_offsets.size() != slots() + 1) ||
+        (!m_choice_offsets.empty() && m_choice_offsets.size() != slots() + 1) ||
+        (!bounded.empty() && (bounded.size() != slots() || m_ranges.size() != slots())))
+        ARGCPP17_THROW(argcpp17_exception::err_invalid_schema_image);
+    if (!bounded.empty()) {
+        // a range of a type outside builtin_value_types is dropped with its converter
+        static constexpr auto numbers = builtin_numbers(std::make_index_sequence<std::tuple_size_v<builtin_value_types>>{});
+        m_numbers.assign(slots(), nullptr);
+        for (size_t i = 0; i < slots(); i++) {
+            auto type = m_value_types[i];
+            m_numbers[i] = bounded[i] && type && type <= numbers.size() ? numbers[type - 1] : nullptr;
+        }
+    }
+    m_completers.resize(slots());
+
+    uint32_t subcommands = 0;
+    reader.read(subcommands);
+    auto resource = m_subcommands.get_allocator().resource();
+    m_subcommands.reserve(subcommands);
+    for (uint32_t i = 0; i < subcommands; i++) {
+        m_subcommands.emplace_back(resource);
+        m_subcommands.back().load_tables(reader);
+    }
+    if (m_description_offsets.size() != slots() + m_subcommands.size() + 1 || !valid_tables())
+        ARGCPP17_THROW(argcpp17_exception::err_invalid_schema_image);
+}
+
+ARGCPP17_INLINE bool prepared_parser::valid_entry(const keyword_index::entry& entry, uint8_t kinds) const
+{
+    if (!(entry.type & kinds))
+        return false;
+    switch (entry.type) {
+        case keyword_index::subcommand_kind:
+            return entry.index < m_subcommands.size();
+        case keyword_index::flag_kind:
+            return entry.index < m_flags;
+        case keyword_index::mandatory_kind:
+            return entry.index < m_mandatories;
+        case keyword_index::optional_kind:
+            return entry.index < m_optionals;
+        case keyword_index::positional_kind:
+            return entry.index < m_positionals;
+        default:
+            return false;
+    }
+}
+
+ARGCPP17_INLINE bool prepared_parser::valid_tables() const
+{
+    constexpr uint8_t option_kinds = keyword_index::flag_kind | keyword_index::mandatory_kind | keyword_index::optional_kind;
+    auto valid_keyword = [this](const keyword_index::entry& entry) { return valid_entry(entry, option_kinds | keyword_index::subcommand_kind); };
+    auto valid_option = [this](const keyword_index::entry& entry) { return valid_entry(entry, option_kinds); };
+    auto valid_positional = [this](const keyword_index::entry& entry) { return valid_entry(entry, keyword_index::positional_kind); };
+    if (!m_index.all_of(valid_keyword) || !m_positional_index.all_of(valid_positional) || !m_option_trie.all_of(valid_option))
+        return false;
+    for (auto& entry : m_short_options)
+        if (entry.type != keyword_index::none && !valid_option(entry))
+            return false;
+
+    for (auto& c : m_candidates)
+        if (c.offset > m_candidate_names.size() || c.length > m_candidate_names.size() - c.offset)
+            return false;
+
+    // offset tables ascend and end within the table they index
+    auto valid_offsets = [](const std::pmr::vector<uint32_t>& offsets, size_t size) {
+        return std::is_sorted(offsets.begin(), offsets.end()) && (offsets.empty() || offsets.back() <= size);
+    };
+    if (!valid_offsets(m_description_offsets, m_descriptions.size()) ||
+        !valid_offsets(m_conflict_offsets, m_conflicts.size()) ||
+        !valid_offsets(m_choice_offsets, m_choices.size()))
+        return false;
+
+    for (auto conflict : m_conflicts)
+        if (conflict >= slots())
+            return false;
+    for (auto& requirement : m_requirements)
+        if (requirement.slot >= slots() || requirement.required >= slots())
+            return false;
+    for (auto& c : m_choices)
+        if (c.offset > m_choice_names.size() || c.length > m_choice_names.size() - c.offset)
+            return false;
+    return true;
+}
+
+ARGCPP17_INLINE std::string_view prepared_parser::description(const keyword& key) const
+{
+    if (m_description_offsets.empty())
+        return {};
+    auto entry = m_index.find_keyword(key);
+    if (!entry)
+        entry = m_positional_index.find_keyword(key);
+    if (!entry)
+        return {};
+    size_t index = entry->type == keyword_index::subcommand_kind ? slots() + entry->index : slot(*entry);
+    return std::string_view(m_descriptions).substr(m_description_offsets[index], m_description_offsets[index + 1] - m_description_offsets[index]);
+}
+
+ARGCPP17_INLINE bool prepared_parser::is_current(const parser& source) const
+{
+    if (m_source != &source || m_generation != source.m_generation || m_subcommands.size() != source.m_subcommands.size())
+        return false;
+    for (size_t i = 0; i < m_subcommands.size(); i++) {
+        auto& sub_command = source.m_subcommands[i];
+        // a deferred subcommand that got built since needs a new schema
+        if (m_subcommands[i].is_deferred() ? sub_command.is_built() : !m_subcommands[i].is_current(*sub_command.m_parser))
+            return false;
+    }
+    return true;
+}
+
+ARGCPP17_INLINE size_t prepared_parser::slot(const keyword_index::entry& entry) const
+{
+    switch (entry.type) {
+        case keyword_index::mandatory_kind:
+            return mandatory_slot(entry.index);
+        case keyword_index::optional_kind:
+            return optional_slot(entry.index);
+        case keyword_index::positional_kind:
+            return positional_slot(entry.index);
+        default:
+            return entry.index;
+    }
+}
+
+ARGCPP17_INLINE bool prepared_parser::parse(int argc, char **args, parse_result& result) const
+{
+    // skip first argument
+    return parse(&args[1], &args[1] + argc - 1, result);
+}
+
+
+ARGCPP17_INLINE bool prepared_parser::parse_lazy(int argc, char **args, parse_result& result, token_range<char**>& rest) const
+{
+    // skip first argument
+    return parse_lazy(&args[1], &args[1] + argc - 1, result, rest);
+}
+
+
+ARGCPP17_INLINE std::pair<prepared_parser::argument_value_type, std::string_view> prepared_parser::check_value_type(std::string_view key, std::string_view arg) const
+{
+    if (arg.substr(key.length(), 1) == "=")
+        return std::make_pair<>(equal_sign, arg.substr(key.length() + 1));
+    else if (arg.substr(key.length(), 1) == ":")
+        return std::make_pair<>(colon, arg.substr(key.length() + 1));
+    else
+        return std::make_pair<>(one_string, arg.substr(key.length()));
+}
+
+ARGCPP17_INLINE bool prepared_parser::update_value(size_t slot, std::string_view value, parse_result& result) const
+{
+    result.m_parsed[slot] = 1;
+    result.m_values[slot] = value;
+    // repeated values keep their own converted value, so bound lists are not converted again
+    auto* cache = &result.m_cache[slot];
+    if (m_repeated[slot]) {
+        result.m_repeated.emplace_back(slot, value);
+        cache = &result.m_repeated_cache.emplace_back();
+    }
+    if (m_converters[slot]) {
+        ARGCPP17_STATS(if (result.m_statistics) result.m_statistics->conversions++;)
+        if (!m_converters[slot](value, *cache))
+            return false;
+    }
+    return (m_numbers.empty() && m_choice_offsets.empty()) || check_value(slot, value, *cache);
+}
+
+ARGCPP17_INLINE bool prepared_parser::check_value(size_t slot, std::string_view value, const std::any& cache) const
+{
+    if (!m_numbers.empty() && m_numbers[slot]) {
+        auto number = m_numbers[slot](cache);
+        // written as a negation so a NaN is out of every range
+        if (!(number >= m_ranges[slot].min && number <= m_ranges[slot].max))
+            return false;
+    }
+    if (m_choice_offsets.empty() || m_choice_offsets[slot] == m_choice_offsets[slot + 1])
+        return true;
+    for (auto i = m_choice_offsets[slot]; i < m_choice_offsets[slot + 1]; i++)
+        if (std::string_view(m_choice_names).substr(m_choices[i].offset, m_choices[i].length) == value)
+            return true;
+    return false;
+}
+
+
+//parser implementations
+ARGCPP17_INLINE void parser::usage(const std::string& app_name)
+{
+    // one buffered write instead of flushing every line
+    auto text = help(app_name);
+    std::fwrite(text.data(), 1, text.size(), stdout);
+    std::fflush(stdout);
+}
+
+ARGCPP17_INLINE std::string_view parser::help(const std::string& app_name, size_t width)
+{
+    if (m_help_generation == m_generation && m_help_width == width && m_help_app == app_name)
+        return m_help;
+
+    struct row {
+        std::string name;
+        std::string_view description;
+    };
+    auto keyword_name = [](const keyword& key) {
+        auto name = key.get_key();
+        if (key.get_abbreviation().has_value())
+            name += ", " + key.get_abbreviation().value();
+        return name;
+    };
+    auto option_name = [&keyword_name](const argument& arg) {
+        return keyword_name(verify_argument_key(arg.get_key())) + (arg.is_repeated() ? " <value>..." : " <value>");
+    };
+    auto positional_name = [](const argument& arg) {
+        return arg.get_key().get_key() + (arg.is_repeated() ? "..." : "");
+    };
+
+    std::pair<const char*, std::vector<row>> sections[] = {
+        { "sub-commands:", {} },
+        { "mandatory options:", {} },
+        { "options:", {} },
+        { "flags:", {} },
+        { "positional arguments:", {} },
+    };
+    for (const auto& i : m_subcommands)
+        sections[0].second.push_back({ keyword_name(i.get_key()), i.get_description() });
+    for (const auto& i : m_mandatories)
+        sections[1].second.push_back({ option_name(i), i.get_description() });
+    for (const auto& i : m_optionals)
+        sections[2].second.push_back({ option_name(i), i.get_description() });
+    for (const auto& i : m_flags)
+        sections[3].second.push_back({ keyword_name(i.get_key()), i.get_description() });
+    for (const auto& i : m_positionals)
+        sections[4].second.push_back({ positional_name(i), i.get_description() });
+
+    // descriptions start in one column behind the longest name, names too long for it get their own line
+    size_t column = 0;
+    for (const auto& section : sections)
+        for (const auto& r : section.second)
+            column = std::max(column, r.name.length());
+    column = std::min(column + 4, width / 2);
+
+    m_help.clear();
+    m_help += app_name;
+    m_help += " [sub-command] <mandatory_options> [options/flags]";
+    for (const auto& positional : m_positionals) {
+        m_help += ' ';
+        m_help += positional_name(positional);
+    }
+    m_help += "\n\n";
+    for (const auto& section : sections) {
+        if (section.second.empty())
+            continue;
+        m_help += section.first;
+        m_help += '\n';
+        for (const auto& r : section.second) {
+            m_help += "  ";
+            m_help += r.name;
+            if (r.name.length() + 4 > column) {
+                m_help += '\n';
+                m_help.append(column, ' ');
+            } else
+                m_help.append(column - r.name.length() - 2, ' ');
+            append_wrapped(m_help, r.description, column, width);
+        }
+    }
+
+    m_help_generation = m_generation;
+    m_help_width = width;
+    m_help_app = app_name;
+    return m_help;
+}
+
+ARGCPP17_INLINE std::vector<std::string> parser::complete(const std::vector<std::string>& words)
+{
+    // build deferred subcommands along the typed path
+    parser* current = this;
+    for (size_t i = 0; i + 1 < words.size(); i++) {
+        auto sub_command = current->find_subcommand(keyword(words[i]));
+        if (!sub_command)
+            break;
+        current = &sub_command->get_parser();
+    }
+
+    std::vector<std::string> candidates;
+    if (words.empty())
+        shared_schema()->complete(words.begin(), words.end(), std::string_view(), candidates);
+    else
+        shared_schema()->complete(words.begin(), std::prev(words.end()), words.back(), candidates);
+    return candidates;
+}
+
+ARGCPP17_INLINE std::string parser::bash_completion(const std::string& app_name)
+{
+    std::string function = "_";
+    for (auto c : app_name)
+        function += std::isalnum((unsigned char) c) ? c : '_';
+    function += "_complete";
+
+    // the script covers the whole tree, so deferred subcommands are built first
+    std::vector<parser*> parsers = { this };
+    while (!parsers.empty()) {
+        auto current = parsers.back();
+        parsers.pop_back();
+        for (auto& sub_command : current->m_subcommands)
+            parsers.push_back(&sub_command.get_parser());
+    }
+
+    // every parser level is identified by the path of subcommands leading to it
+    // the schema of the whole tree is prepared once and walked along with the parsers
+    auto schema = shared_schema();
+    std::string paths;
+    std::string words;
+    std::vector<std::tuple<std::string, const parser*, const prepared_parser*>> stack = { { std::string(), this, schema.get() } };
+    while (!stack.empty()) {
+        auto [path, current, level] = stack.back();
+        stack.pop_back();
+        if (!path.empty()) {
+            paths += paths.empty() ? "" : "|";
+            paths += path;
+        }
+        words += "        \"" + path + "\") words=\"";
+        append_completion_words(*level, words);
+        words += "\";;\n";
+        for (size_t i = current->m_subcommands.size(); i-- > 0;) {
+            auto& sub_command = current->m_subcommands[i];
+            stack.push_back({ path + "/" + sub_command.get_key().get_key(), sub_command.m_parser.get(), &level->m_subcommands[i] });
+        }
+    }
+
+    std::string script;
+    script += function + "()\n{\n";
+    script += "    local path=\"\" words=\"\" i\n";
+    script += "    for ((i = 1; i < COMP_CWORD; i++)); do\n";
+    script += "        case \"$path/${COMP_WORDS[i]}\" in\n";
+    if (!paths.empty())
+        script += "            " + paths + ") path=\"$path/${COMP_WORDS[i]}\";;\n";
+    script += "            *) break;;\n";
+    script += "        esac\n";
+    script += "    done\n";
+    script += "    case \"$path\" in\n";
+    script += words;
+    script += "    esac\n";
+    script += "    COMPREPLY=( $(compgen -W \"$words\" -- \"${COMP_WORDS[COMP_CWORD]}\") )\n";
+    script += "}\n";
+    script += "complete -F " + function + " " + app_name + "\n";
+    return script;
+}
+
+ARGCPP17_INLINE void parser::append_completion_words(const prepared_parser& schema, std::string& out)
+{
+    // the sorted candidate table of the prepared schema
+    for (size_t i = 0; i < schema.m_candidates.size(); i++) {
+        if (i)
+            out += ' ';
+        out += schema.candidate_name(schema.m_candidates[i]);
+    }
+}
+
+ARGCPP17_INLINE argument* parser::find_argument(const keyword& key, bool positionals)
+{
+    auto entry = m_index.find_keyword(key, keyword_index::optional_kind | keyword_index::mandatory_kind);
+    argument* arg = nullptr;
+    if (entry && entry->type == keyword_index::optional_kind)
+        arg = &m_optionals[entry->index];
+    else if (entry)
+        arg = &m_mandatories[entry->index];
+    else if (positionals && (entry = m_positional_index.find_keyword(key)))
+        arg = &m_positionals[entry->index];
+    if (!arg)
+        ARGCPP17_THROW(argcpp17_exception::err_unknown_keyword);
+    return arg;
+}
+
+ARGCPP17_INLINE const argument& parser::argument_at(const keyword_index::entry& entry) const
+{
+    switch (entry.type) {
+        case keyword_index::mandatory_kind:
+            return m_mandatories[entry.index];
+        case keyword_index::optional_kind:
+            return m_optionals[entry.index];
+        default:
+            return m_positionals[entry.index];
+    }
+}
+
+ARGCPP17_INLINE keyword_index::entry parser::find_entry(const keyword& key) const
+{
+    auto entry = m_index.find_keyword(key, keyword_index::flag_kind | keyword_index::mandatory_kind | keyword_index::optional_kind);
+    if (!entry)
+        entry = m_positional_index.find_keyword(key);
+    if (!entry)
+        ARGCPP17_THROW(argcpp17_exception::err_unknown_keyword);
+    return *entry;
+}
+
+ARGCPP17_INLINE parser& parser::add_requirement(const keyword& key, const keyword& required)
+{
+    m_requirements.push_back({ find_entry(key), find_entry(required) });
+    changed();
+    return *this;
+}
+
+ARGCPP17_INLINE parser& parser::add_conflict(const keyword& key, const keyword& other)
+{
+    // an argument conflicting with itself could never be given
+    auto first = find_entry(key);
+    auto second = find_entry(other);
+    if (first.type == second.type && first.index == second.index)
+        ARGCPP17_THROW(argcpp17_exception::err_conflicting_arguments);
+    m_conflicts.push_back({ first, second });
+    changed();
+    return *this;
+}
+
+ARGCPP17_INLINE parser& parser::add_choices(const keyword& key, std::vector<std::string> choices)
+{
+    find_argument(key, true)->m_choices = std::move(choices);
+    changed();
+    return *this;
+}
+
+ARGCPP17_INLINE flag_handle parser::get_flag_handle(const keyword& key) const
+{
+    auto entry = m_index.find_keyword(key, keyword_index::flag_kind);
+    if (!entry)
+        ARGCPP17_THROW(argcpp17_exception::err_unknown_keyword);
+    return flag_handle(this, entry->index);
+}
+
+ARGCPP17_INLINE parser& parser::set_completer(const keyword& key, value_completer completer)
+{
+    find_argument(key, true)->m_completer = std::move(completer);
+    changed();
+    return *this;
+}
+
+ARGCPP17_INLINE parser& parser::bind_environment(const keyword& key, std::string variable)
+{
+    find_argument(key, false)->m_environment = std::move(variable);
+    changed();
+    return *this;
+}
+
+ARGCPP17_INLINE parser& parser::bind_config(const keyword& key, std::string config_key)
+{
+    find_argument(key, false)->m_config_key = std::move(config_key);
+    changed();
+    return *this;
+}
+
+ARGCPP17_INLINE parser& parser::load_config(const std::string& path)
+{
+    response_file file;
+    if (!file.open(path))
+        ARGCPP17_THROW(argcpp17_exception::err_config_file);
+
+    auto trim = [](std::string_view text) {
+        auto first = text.find_first_not_of(" \t\r");
+        if (first == std::string_view::npos)
+            return std::string_view();
+        return text.substr(first, text.find_last_not_of(" \t\r") - first + 1);
+    };
+    std::string_view content(file.data(), file.size());
+    while (!content.empty()) {
+        auto end = content.find('\n');
+        auto line = trim(content.substr(0, end));
+        content.remove_prefix(end == std::string_view::npos ? content.size() : end + 1);
+        auto separator = line.find('=');
+        if (line.empty() || line.front() == '#' || separator == std::string_view::npos)
+            continue;
+        m_config.insert_or_assign(std::string(trim(line.substr(0, separator))), std::string(trim(line.substr(separator + 1))));
+    }
+    changed();
+    return *this;
+}
+
+ARGCPP17_INLINE parser& parser::set_config(std::string config_key, std::string value)
+{
+    m_config.insert_or_assign(std::move(config_key), std::move(value));
+    changed();
+    return *this;
+}
+
+ARGCPP17_INLINE void parser::append_wrapped(std::string& out, std::string_view text, size_t column, size_t width)
+{
+    auto is_space = [](char c) { return c == ' ' || c == '\t' || c == '\n'; };
+    size_t line = column;
+    bool line_start = true;
+    size_t pos = 0;
+    while (pos < text.length()) {
+        while (pos < text.length() && is_space(text[pos]))
+            pos++;
+        size_t word_end = pos;
+        while (word_end < text.length() && !is_space(text[word_end]))
+            word_end++;
+        if (word_end == pos)
+            break;
+        auto word = text.substr(pos, word_end - pos);
+        pos = word_end;
+
+        // words longer than a line are not split
+        if (!line_start && line + 1 + word.length() > width) {
+            out += '\n';
+            out.append(column, ' ');
+            line = column;
+            line_start = true;
+        }
+        if (!line_start) {
+            out += ' ';
+            line++;
+        }
+        out += word;
+        line += word.length();
+        line_start = false;
+    }
+    out += '\n';
+}
+
+ARGCPP17_INLINE void parser::parse(int argc, char **args, storage_mode mode) {
+    auto status = try_parse(argc, args, mode);
+    if (!status)
+        ARGCPP17_THROW(status.error);
+}
+
+ARGCPP17_INLINE parse_status parser::try_parse(int argc, char **args, storage_mode mode) {
+    // skip first argument
+    return parse_expanded(&args[1], &args[1] + argc - 1, mode);
+}
+
+ARGCPP17_INLINE void parser::parse(int argc, wchar_t **args, storage_mode mode)
+{
+    auto status = try_parse(argc, args, mode);
+    if (!status)
+        ARGCPP17_THROW(status.error);
+}
+
+ARGCPP17_INLINE parse_status parser::try_parse(int argc, wchar_t **args, storage_mode mode)
+{
+    m_wide_tokens.assign(argc, args);
+    return parse_expanded(m_wide_tokens.begin(), m_wide_tokens.end(), mode);
+}
+
+ARGCPP17_INLINE void parser::parse(std::wstring_view command_line, storage_mode mode)
+{
+    auto status = try_parse(command_line, mode);
+    if (!status)
+        ARGCPP17_THROW(status.error);
+}
+
+ARGCPP17_INLINE parse_status parser::try_parse(std::wstring_view command_line, storage_mode mode)
+{
+    m_wide_tokens.assign(command_line);
+    return parse_expanded(m_wide_tokens.begin(), m_wide_tokens.end(), mode);
+}
+
+ARGCPP17_INLINE token_range<char**> parser::parse_lazy(int argc, char **args, storage_mode mode)
+{
+    token_range<char**> rest;
+    auto status = try_parse_lazy(argc, args, rest, mode);
+    if (!status)
+        ARGCPP17_THROW(status.error);
+    return rest;
+}
+
+ARGCPP17_INLINE parse_status parser::try_parse_lazy(int argc, char **args, token_range<char**>& rest, storage_mode mode)
+{
+    m_response_files.clear();
+    do {
+        ARGCPP17_STATS(begin_statistics();)
+        shared_schema()->parse_lazy(argc, args, m_result, rest);
+        ARGCPP17_STATS(end_statistics();)
+    } while (is_deferred(m_result) && build_deferred(m_result));
+    apply_result(mode);
+    return m_result.status();
+}
+
+ARGCPP17_INLINE std::optional<int> parser::dispatch(int argc, char **args, storage_mode mode)
+{
+    parse(argc, args, mode);
+
+    subcommand<parser>* selected = nullptr;
+    parser* current = this;
+    for (bool found = true; found;) {
+        found = false;
+        for (auto& sub_command : current->m_subcommands)
+            if (sub_command.is_parsed()) {
+                if (sub_command.m_handler)
+                    selected = &sub_command;
+                current = &sub_command.get_parser();
+                found = true;
+                break;
+            }
+    }
+    if (!selected)
+        return std::nullopt;
+    return selected->m_handler(selected->get_parser());
+}
+
+ARGCPP17_INLINE parser& parser::enable_response_files(size_t max_depth)
+{
+    m_response_depth = max_depth;
+    return *this;
+}
+
+ARGCPP17_INLINE subcommand<parser>* parser::find_subcommand(const keyword& key)
+{
+    auto entry = m_index.find_keyword(key, keyword_index::subcommand_kind);
+    return entry ? &m_subcommands[entry->index] : nullptr;
+}
+
+
+ARGCPP17_INLINE parser& parser::get_subcommand_parser(const keyword& key)
+{
+    auto sub_command = find_subcommand(key);
+    if (!sub_command)
+        ARGCPP17_THROW(argcpp17_exception::err_subcommand_not_found);
+    return sub_command->get_parser();
+}
+
+ARGCPP17_INLINE parser* parser::find_subcommand_parser(const keyword& key)
+{
+    auto sub_command = find_subcommand(key);
+    return sub_command ? &sub_command->get_parser() : nullptr;
+}
+
+ARGCPP17_INLINE void parser::check_keyword(const keyword& key, keyword_index::kind type, size_t index)
+{
+    if (!m_index.insert_keyword(key, type, (uint32_t) index))
+        ARGCPP17_THROW(argcpp17_exception::err_duplicate_keyword);
+}
+
+ARGCPP17_INLINE void parser::check_option_keyword(const keyword& key, keyword_index::kind type, size_t index)
+{
+    // keys and abbreviations only differ in their prefix after normalization
+    auto option_key = verify_argument_key(key);
+    auto& abbr = option_key.get_abbreviation();
+    if (m_option_trie.contains(option_key.get_key()) || (abbr.has_value() && m_option_trie.contains(abbr.value())))
+        ARGCPP17_THROW(argcpp17_exception::err_duplicate_keyword);
+    check_keyword(key, type, index);
+
+    keyword_index::entry entry = { type, (uint32_t) index };
+    m_option_trie.insert(option_key.get_key(), entry);
+    if (abbr.has_value())
+        m_option_trie.insert(abbr.value(), entry);
+}
+
+ARGCPP17_INLINE parser& parser::add_subcommand(std::string key, std::string description)
+{
+    keyword kw = { std::move(key) };
+    check_keyword(kw, keyword_index::subcommand_kind, m_subcommands.size());
+    // growing the vector moves subcommands, their parsers stay in place
+    m_subcommands.emplace_back(std::move(kw), std::move(description));
+    changed();
+    return m_subcommands.back().get_parser();
+}
+
+ARGCPP17_INLINE parser& parser::add_subcommand(std::string key, std::string description, subcommand_builder builder, subcommand_handler handler)
+{
+    keyword kw = { std::move(key) };
+    check_keyword(kw, keyword_index::subcommand_kind, m_subcommands.size());
+    m_subcommands.emplace_back(std::move(kw), std::move(description), std::move(builder), std::move(handler));
+    changed();
+    return *this;
+}
+
+ARGCPP17_INLINE parser& parser::add_flag(keyword key, std::string description)
+{
+    check_keyword(key, keyword_index::flag_kind, m_flags.size());
+    m_flags.emplace_back(std::move(key), std::move(description));
+    changed();
+    return *this;
+}
+
+ARGCPP17_INLINE parser& parser::add_flag(keyword key, std::string description, bool* target)
+{
+    add_flag(std::move(key), std::move(description));
+    m_flags.back().m_target = target;
+    return *this;
+}
+
+ARGCPP17_INLINE parser& parser::add_mandatory_argument(keyword key, std::string description)
+{
+    check_option_keyword(key, keyword_index::mandatory_kind, m_mandatories.size());
+    m_mandatories.emplace_back(std::move(key), std::move(description));
+    changed();
+    return *this;
+}
+
+ARGCPP17_INLINE parser& parser::add_optional_argument(keyword key, std::string description)
+{
+    check_option_keyword(key, keyword_index::optional_kind, m_optionals.size());
+    m_optionals.emplace_back(std::move(key), std::move(description));
+    changed();
+    return *this;
+}
+
+ARGCPP17_INLINE parser& parser::add_argument(keyword key, std::string description, bool optional)
+{
+    if (optional)
+        return add_optional_argument(std::move(key), std::move(description));
+    return add_mandatory_argument(std::move(key), std::move(description));
+}
+
+ARGCPP17_INLINE parser& parser::add_positional(std::string name, std::string description)
+{    
+    if (!m_positionals.empty() && m_positionals.back().m_repeated)
+        ARGCPP17_THROW(argcpp17_exception::err_positional_after_list);
+    // positional names are not unique, first one wins on lookup
+    m_positional_index.insert(name, keyword_index::positional_kind, (uint32_t) m_positionals.size());
+    m_positionals.emplace_back(std::move(name), std::move(description));
+    changed();
+    return *this;
+}
+
+ARGCPP17_INLINE parser& parser::add_repeated_argument(keyword key, std::string description)
+{
+    add_optional_argument(std::move(key), std::move(description));
+    m_optionals.back().m_repeated = true;
+    return *this;
+}
+
+ARGCPP17_INLINE parser& parser::add_positional_list(std::string name, std::string description)
+{
+    add_positional(std::move(name), std::move(description));
+    m_positionals.back().m_repeated = true;
+    return *this;
+}
+
+ARGCPP17_INLINE void parser::parse_vector(std::vector<std::string>& args)
+{
+    auto status = try_parse_vector(args);
+    if (!status)
+        ARGCPP17_THROW(status.error);
+}
+
+ARGCPP17_INLINE parse_status parser::try_parse_vector(std::vector<std::string>& args)
+{
+    return parse_expanded(args.begin(), args.end(), copy_values);
+}
+
+ARGCPP17_INLINE void parser::changed()
+{
+    m_generation++;
+    m_prepared.reset();
+}
+
+ARGCPP17_INLINE void parser::reset()
+{
+    for (auto &it : m_subcommands) it.reset();
+    for (auto &it : m_flags) it.reset();
+    for (auto &it : m_optionals) it.reset();
+    for (auto &it : m_mandatories) it.reset();
+    for (auto &it : m_positionals) it.reset();
+}
+
+
+ARGCPP17_INLINE std::shared_ptr<const prepared_parser> parser::shared_schema()
+{
+    // sub parsers may have changed as well, so check the whole tree
+    if (!m_prepared || !m_prepared->is_current(*this))
+        m_prepared = std::make_shared<const prepared_parser>(*this ARGCPP17_STATS(, statistics_resource()));
+    return m_prepared;
+}
+
+
+#if defined(ARGCPP17_ENABLE_STATS)
+ARGCPP17_INLINE void parser::begin_statistics()
+{
+    m_statistics.clear();
+    // allocations are the difference of the thread counters
+    auto& counters = counting_resource::thread_counters();
+    m_statistics.allocations = counters.allocations;
+    m_statistics.allocated_bytes = counters.bytes;
+    m_result.record_statistics(&m_statistics);
+}
+
+ARGCPP17_INLINE void parser::end_statistics()
+{
+    auto& counters = counting_resource::thread_counters();
+    m_statistics.allocations = counters.allocations - m_statistics.allocations;
+    m_statistics.allocated_bytes = counters.bytes - m_statistics.allocated_bytes;
+    m_result.record_statistics(nullptr);
+}
+#endif
+
+ARGCPP17_INLINE bool parser::is_deferred(const parse_result& result)
+{
+    return !result.ok() && result.error() == argcpp17_exception::err_subcommand_deferred;
+}
+
+ARGCPP17_INLINE bool parser::build_deferred(const parse_result& result)
+{
+    // follow the selected subcommands down to the one that is not built yet
+    parser* current = this;
+    const parse_result* level = &result;
+    while (level && level->subcommand() != parse_result::npos) {
+        auto& sub_command = current->m_subcommands[level->subcommand()];
+        if (!sub_command.is_built()) {
+            sub_command.get_parser();
+            return true;
+        }
+        current = &sub_command.get_parser();
+        level = level->subcommand_result();
+    }
+    return false;
+}
+
+ARGCPP17_INLINE void parser::apply_result(storage_mode mode)
+{
+#if defined(ARGCPP17_ENABLE_STATS)
+    // the copies of copy_values use the std allocator, their growth is counted with the parse
+    auto& counters = counting_resource::thread_counters();
+    auto allocations = counters.allocations;
+    auto bytes = counters.bytes;
+#endif
+    apply(m_result, mode);
+    ARGCPP17_STATS(
+        m_statistics.allocations += counters.allocations - allocations;
+        m_statistics.allocated_bytes += counters.bytes - bytes;
+    )
+}
+
+ARGCPP17_INLINE void parser::apply(const parse_result& result, storage_mode mode)
+{
+    reset();
+
+    if (result.subcommand() != parse_result::npos) {
+        auto& sub_command = m_subcommands[result.subcommand()];
+        sub_command.get_parser().apply(result.m_subcommand_result.front(), mode);
+        if (result.ok())
+            sub_command.mark_parsed();
+        return;
+    }
+
+    auto& schema = *result.m_schema;
+    for (size_t i = 0; i < m_flags.size(); i++)
+        if (result.m_parsed[i]) {
+            m_flags[i].mark_parsed();
+            if (m_flags[i].m_target && result.ok())
+                *static_cast<bool*>(m_flags[i].m_target) = true;
+        }
+    for (size_t i = 0; i < m_mandatories.size(); i++)
+        update_argument(m_mandatories[i], result, schema.mandatory_slot(i), mode);
+    for (size_t i = 0; i < m_optionals.size(); i++)
+        update_argument(m_optionals[i], result, schema.optional_slot(i), mode);
+    for (size_t i = 0; i < m_positionals.size(); i++)
+        update_argument(m_positionals[i], result, schema.positional_slot(i), mode);
+}
+
+ARGCPP17_INLINE void parser::update_argument(argument& arg, const parse_result& result, size_t slot, storage_mode mode)
+{
+    if (!result.m_parsed[slot])
+        return;
+    arg.mark_parsed();
+    auto value = result.m_values[slot];
+    if (mode == view_values) {
+        arg.update_view(value);
+        arg.m_cache.assign(result.m_cache[slot]);
+    } else {
+        arg.update_copy(value);
+        arg.m_cache.assign_copy(result.m_cache[slot]);
+    }
+    if (arg.m_repeated) {
+        if (mode == view_values)
+            arg.m_list.assign_views(result.slot_values(slot));
+        else
+            arg.m_list.assign(result.slot_values(slot));
+    }
+    // bound arguments keep their values for get_value and handles as well
+    if (!arg.m_binder || !result.ok())
+        return;
+    // string views in copy_values refer to the copies of the argument instead of the tokens
+    if (mode == copy_values && arg.m_converter == &convert_cached<std::string_view>)
+        arg.m_binder(arg.m_cache.get(), arg.m_list.values(), nullptr, arg.m_target);
+    else
+        arg.m_binder(result.m_cache[slot], result.slot_values(slot), result.slot_cache(slot), arg.m_target);
+}
+
+
+ARGCPP17_INLINE value_list parser::get_values(const keyword& key) const
+{
+    auto entry = m_index.find_keyword(key, keyword_index::optional_kind);
+    if (entry)
+        return m_optionals[entry->index].values();
+    entry = m_positional_index.find_keyword(key);
+    if (entry)
+        return m_positionals[entry->index].values();
+    return value_list();
+}
+
+ARGCPP17_INLINE bool parser::get_flag(const keyword& key)
+{
+    auto entry = m_index.find_keyword(key, keyword_index::flag_kind);
+    if (entry)
+        return m_flags[entry->index].is_set();
+    return false;
+}
+
+
+//flag_handle implementations
+ARGCPP17_INLINE bool flag_handle::is_set() const
+{
+    return m_parser && m_parser->m_flags[m_index].is_set();
+}
+
+
+//static_keyword implementations
+ARGCPP17_INLINE static_keyword::operator keyword() const
+{
+    if (abbreviation.empty())
+        return keyword(std::string(key));
+    return keyword(std::string(key), std::string(abbreviation));
+}
+
+#endif
@@ -0,0 +1,45 @@
+// C++20 module interface of argcpp17, exports the public names of argcpp17.h
+// the non-template functions come from the argcpp17 library
+module;
+
+#include <argcpp17.h>
+
+export module argcpp17;
+
+export {
+    using ::parse_value;
+    using ::convert_value;
+    using ::value_converter;
+    using ::enum_names;
+    using ::byte_size;
+    using ::builtin_value_types;
+    using ::argcpp17_exception;
+    using ::argcpp17_abort;
+    using ::parse_status;
+    using ::parse_statistics;
+    using ::value_completer;
+    using ::keyword;
+    using ::argument;
+    using ::subcommand;
+    using ::flag;
+    using ::optional_argument;
+    using ::mandatory_argument;
+    using ::positional_argument;
+    using ::value_list;
+    using ::response_file;
+    using ::response_expander;
+    using ::token_range;
+    using ::option_handle;
+    using ::flag_handle;
+    using ::parse_result;
+    using ::batch_result;
+    using ::prepared_parser;
+    using ::parser;
+    using ::static_keyword;
+    using ::static_flag;
+    using ::static_optional;
+    using ::static_mandatory;
+    using ::static_positional;
+    using ::static_parser;
+    using ::operator<<;
+}
@@ -0,0 +1,7 @@
+// compiled part of argcpp17, the non-template functions of the library
+#if defined(ARGCPP17_HEADER_ONLY)
+#error "the argcpp17 library is not built in header only mode"
+#endif
+
+#include <argcpp17.h>
+#include <argcpp17_impl.h>
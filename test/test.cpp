@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 #include <argcpp17.h>
+#include <atomic>
+#include <fstream>
+#include <thread>
 
 
 static const std::string KEY = "my_key";
@@ -9,6 +12,28 @@ static const std::string ANOTHER_KEY = "another_key";
 static const std::string VALUE = "my_value";
 
 
+// count heap allocations to verify allocation free code paths
+static std::atomic<size_t> allocations{0};
+
+void* operator new(size_t size)
+{
+    allocations++;
+    if (void* ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv); 
     return RUN_ALL_TESTS();
@@ -83,6 +108,125 @@ TEST(keyword_test, operator_equal_string)
     EXPECT_FALSE(kw1 == ANOTHER_KEY);
 }
 
+enum test_color
+{
+    red,
+    green,
+    blue
+};
+
+template<>
+struct enum_names<test_color> {
+    static constexpr std::pair<std::string_view, test_color> values[] = { { "red", red }, { "green", green }, { "blue", blue } };
+};
+
+// value type whose conversion throws instead of failing
+struct throwing_value {};
+
+template<>
+struct value_converter<throwing_value> {
+    static bool convert(std::string_view value, throwing_value&) {
+        if (value == "throw")
+            throw std::runtime_error("conversion failed");
+        return true;
+    }
+};
+
+// value type counting its conversions
+struct counted_value {
+    static inline int conversions = 0;
+    std::string_view value;
+};
+
+template<>
+struct value_converter<counted_value> {
+    static bool convert(std::string_view value, counted_value& result) {
+        counted_value::conversions++;
+        result.value = value;
+        return true;
+    }
+};
+
+TEST(parse_value_test, arithmetic)
+{
+    EXPECT_EQ(parse_value<int>(std::string_view("-3")), -3);
+    EXPECT_EQ(parse_value<int>(std::string_view("+3")), 3);
+    EXPECT_EQ(parse_value<uint8_t>(std::string_view("255")), 255);
+    EXPECT_EQ(parse_value<double>(std::string_view("3.14")), 3.14);
+    EXPECT_EQ(parse_value<float>(std::string_view("-0.5")), -0.5f);
+    EXPECT_EQ(parse_value<char>(std::string_view("x")), 'x');
+    EXPECT_TRUE(parse_value<bool>(std::string_view("true")));
+    EXPECT_FALSE(parse_value<bool>(std::string_view("0")));
+
+    EXPECT_THROW(parse_value<int>(std::string_view("3x")), argcpp17_exception);
+    EXPECT_THROW(parse_value<int>(std::string_view("")), argcpp17_exception);
+    EXPECT_THROW(parse_value<uint8_t>(std::string_view("256")), argcpp17_exception);
+    EXPECT_THROW(parse_value<unsigned>(std::string_view("-1")), argcpp17_exception);
+    EXPECT_THROW(parse_value<double>(std::string_view("pi")), argcpp17_exception);
+    EXPECT_THROW(parse_value<bool>(std::string_view("maybe")), argcpp17_exception);
+
+    int result = 0;
+    EXPECT_FALSE(convert_value(std::string_view("abc"), result));
+    EXPECT_TRUE(convert_value(std::string_view("42"), result));
+    EXPECT_EQ(result, 42);
+}
+
+TEST(parse_value_test, hooks)
+{
+    EXPECT_EQ(parse_value<test_color>(std::string_view("green")), green);
+    EXPECT_THROW(parse_value<test_color>(std::string_view("purple")), argcpp17_exception);
+
+    using namespace std::chrono;
+    EXPECT_EQ(parse_value<milliseconds>(std::string_view("250ms")), milliseconds(250));
+    EXPECT_EQ(parse_value<milliseconds>(std::string_view("2s")), milliseconds(2000));
+    EXPECT_EQ(parse_value<seconds>(std::string_view("5min")), seconds(300));
+    EXPECT_EQ(parse_value<seconds>(std::string_view("10")), seconds(10));
+    EXPECT_THROW(parse_value<seconds>(std::string_view("10 parsecs")), argcpp17_exception);
+
+    EXPECT_EQ(parse_value<byte_size>(std::string_view("4KiB")), 4096u);
+    EXPECT_EQ(parse_value<byte_size>(std::string_view("16M")), 16u << 20);
+    EXPECT_EQ(parse_value<byte_size>(std::string_view("1GB")), 1000000000u);
+    EXPECT_EQ(parse_value<byte_size>(std::string_view("512")), 512u);
+    EXPECT_THROW(parse_value<byte_size>(std::string_view("4XB")), argcpp17_exception);
+    EXPECT_THROW(parse_value<byte_size>(std::string_view("99999999999T")), argcpp17_exception);
+}
+
+TEST(argument_value_test, assign)
+{
+    argument_value value;
+    EXPECT_FALSE(value.has_value());
+
+    value.assign(VALUE);
+    EXPECT_TRUE(value.has_value());
+    EXPECT_FALSE(value.is_view());
+    EXPECT_EQ(value.view(), VALUE);
+    EXPECT_NE(value.view().data(), VALUE.data());
+
+    value.assign_view(VALUE);
+    EXPECT_TRUE(value.is_view());
+    EXPECT_EQ(value.view().data(), VALUE.data());
+
+    value.clear();
+    EXPECT_FALSE(value.has_value());
+    EXPECT_TRUE(value.view().empty());
+}
+
+TEST(argument_value_test, copy_constructor)
+{
+    auto original = std::make_unique<argument_value>();
+    original->assign(VALUE);
+    argument_value copy(*original);
+    original.reset();
+    EXPECT_TRUE(copy.has_value());
+    EXPECT_EQ(copy.view(), VALUE);
+
+    argument_value view;
+    view.assign_view(VALUE);
+    argument_value view_copy(view);
+    EXPECT_TRUE(view_copy.is_view());
+    EXPECT_EQ(view_copy.view().data(), VALUE.data());
+}
+
 class argument_test : public ::testing::Test {
 public:
     argument_test()
@@ -284,6 +428,72 @@ TEST_F(positional_test, update_value)
     EXPECT_EQ(sut.value<std::string>(), VALUE);
 }
 
+TEST(keyword_index_test, insert_and_find)
+{
+    keyword_index index;
+    EXPECT_EQ(index.find(KEY), nullptr);
+
+    EXPECT_TRUE(index.insert_keyword({KEY, ABBR}, keyword_index::flag_kind, 3));
+    EXPECT_EQ(index.size(), 2);
+    EXPECT_FALSE(index.insert_keyword({ANOTHER_KEY, ABBR}, keyword_index::optional_kind, 4));
+    EXPECT_FALSE(index.insert(KEY, keyword_index::optional_kind, 4));
+
+    auto entry = index.find(ABBR);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->type, keyword_index::flag_kind);
+    EXPECT_EQ(entry->index, 3);
+
+    EXPECT_NE(index.find_keyword({ANOTHER_KEY, KEY}), nullptr);
+    EXPECT_EQ(index.find_keyword({KEY}, keyword_index::optional_kind), nullptr);
+    EXPECT_EQ(index.find(ANOTHER_KEY), nullptr);
+}
+
+TEST(keyword_index_test, grow)
+{
+    keyword_index index;
+    for (uint32_t i = 0; i < 1000; i++)
+        EXPECT_TRUE(index.insert("key" + std::to_string(i), keyword_index::optional_kind, i));
+    EXPECT_EQ(index.size(), 1000);
+    for (uint32_t i = 0; i < 1000; i++) {
+        auto entry = index.find("key" + std::to_string(i));
+        ASSERT_NE(entry, nullptr);
+        EXPECT_EQ(entry->index, i);
+    }
+    EXPECT_EQ(index.find("key1000"), nullptr);
+}
+
+TEST(option_trie_test, longest_prefix)
+{
+    option_trie trie;
+    EXPECT_TRUE(trie.insert("--o", { keyword_index::optional_kind, 0 }));
+    EXPECT_TRUE(trie.insert("--out", { keyword_index::optional_kind, 1 }));
+    EXPECT_TRUE(trie.insert("-O", { keyword_index::mandatory_kind, 2 }));
+    EXPECT_FALSE(trie.insert("--out", { keyword_index::optional_kind, 3 }));
+    EXPECT_EQ(trie.size(), 3);
+
+    size_t length = 0;
+    auto entry = trie.longest_prefix("--output", length);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->index, 1);
+    EXPECT_EQ(length, 5);
+
+    entry = trie.longest_prefix("--ou", length);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->index, 0);
+    EXPECT_EQ(length, 3);
+
+    entry = trie.longest_prefix("-Ovalue", length);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->type, keyword_index::mandatory_kind);
+
+    EXPECT_EQ(trie.longest_prefix("value", length), nullptr);
+    EXPECT_EQ(trie.longest_prefix("-", length), nullptr);
+
+    EXPECT_TRUE(trie.contains("--o"));
+    EXPECT_FALSE(trie.contains("--ou"));
+    EXPECT_EQ(trie.ambiguous_prefixes(), std::vector<std::string>({ "--o" }));
+}
+
 class parser_test : public ::testing::Test {
 public:
     parser_test() = default;
@@ -297,6 +507,7 @@ public:
         ~derived_parser() = default;
 
         using parser::parse_vector;
+        using parser::try_parse_vector;
     };
 
 protected:
@@ -554,4 +765,1405 @@ TEST_F(parser_test, parse_values)
         EXPECT_TRUE(value.has_value());
         EXPECT_EQ(value.value(), -3);
     }
-}
\ No newline at end of file
+}
+
+TEST_F(parser_test, parse_view_values)
+{
+    char app[] = "app";
+    char option[] = "-ovalue";
+    char mandatory[] = "--mandatory";
+    char mandatory_value[] = "42";
+    char flag[] = "f";
+    char input[] = "input_file";
+    char* args[] = { app, option, mandatory, mandatory_value, flag, input };
+
+    sut.add_flag({"flag", "f"}, DESC)
+       .add_optional_argument({"option", "o"}, DESC)
+       .add_mandatory_argument({"mandatory", "m"}, DESC)
+       .add_positional("input", DESC);
+
+    EXPECT_NO_THROW(sut.parse(6, args, parser::view_values));
+    EXPECT_TRUE(sut.get_flag({"flag"}));
+
+    auto option_value = sut.get_value<std::string_view>({"option"});
+    EXPECT_EQ(option_value.value(), "value");
+    EXPECT_EQ(option_value.value().data(), option + 2);
+
+    auto mandatory_value_view = sut.get_value<std::string_view>({"mandatory"});
+    EXPECT_EQ(mandatory_value_view.value().data(), mandatory_value);
+    EXPECT_EQ(sut.get_value<int>({"mandatory"}), 42);
+
+    auto input_value = sut.get_value<std::string_view>({"input"});
+    EXPECT_EQ(input_value.value().data(), input);
+
+    // copy mode does not reference argv
+    EXPECT_NO_THROW(sut.parse(6, args, parser::copy_values));
+    EXPECT_EQ(sut.get_value<std::string>({"option"}), "value");
+    EXPECT_NE(sut.get_value<std::string_view>({"option"}).value().data(), option + 2);
+}
+
+TEST_F(parser_test, parse_copy_values_list)
+{
+    char app[] = "app";
+    char first[] = "-Dfoo";
+    char second[] = "-Dbar";
+    char* args[] = { app, first, second };
+
+    sut.add_repeated_argument({"define", "D"}, DESC);
+
+    EXPECT_NO_THROW(sut.parse(3, args, parser::copy_values));
+    // copies stay valid when argv changes and when the parser is copied
+    std::fill(first, first + sizeof(first) - 1, 'x');
+    std::fill(second, second + sizeof(second) - 1, 'x');
+    parser copy = sut;
+    auto check = [](const parser& p) {
+        auto list = p.get_values({"define"});
+        ASSERT_EQ(list.size(), 2);
+        EXPECT_EQ(list[0], "foo");
+        EXPECT_EQ(list[1], "bar");
+    };
+    check(sut);
+    check(copy);
+}
+
+TEST_F(parser_test, parse_copy_values_views)
+{
+    std::string_view bound;
+    std::vector<std::string_view> bound_list;
+    sut.add_optional_argument({"name", "n"}, DESC)
+       .add_optional_argument({"label"}, DESC, &bound)
+       .add_repeated_argument({"tag"}, DESC, &bound_list);
+    auto name = sut.get_handle<std::string_view>({"name"});
+
+    // string views read after the tokens are gone refer to the copies of the parser
+    {
+        std::vector<std::string> args = {"-n", "first", "--label=second", "--tag", "third"};
+        EXPECT_NO_THROW(sut.parse_vector(args));
+    }
+    std::vector<std::string> reuse = {"xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx", "yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy"};
+    ASSERT_TRUE(name);
+    EXPECT_EQ(*name, "first");
+    EXPECT_EQ(sut.get_value<std::string_view>({"name"}), "first");
+    EXPECT_EQ(bound, "second");
+    ASSERT_EQ(bound_list.size(), 1);
+    EXPECT_EQ(bound_list[0], "third");
+
+    // and to the copies of a copied parser
+    auto original = std::make_unique<parser>(sut);
+    parser copy = *original;
+    original.reset();
+    EXPECT_EQ(copy.get_value<std::string_view>({"name"}), "first");
+}
+
+TEST_F(parser_test, parse_single_pass)
+{
+    std::vector<std::string> args;
+
+    sut.add_flag({"flag", "f"}, DESC)
+       .add_optional_argument({"option", "o"}, DESC)
+       .add_positional("first", DESC)
+       .add_positional("second", DESC);
+
+    // options, flags and positionals may be interleaved
+    args = {"one", "-o", "f", "f", "two"};
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    EXPECT_EQ(sut.get_value<std::string>({"option"}), "f");
+    EXPECT_TRUE(sut.get_flag({"flag"}));
+    EXPECT_EQ(sut.get_value<std::string>({"first"}), "one");
+    EXPECT_EQ(sut.get_value<std::string>({"second"}), "two");
+
+    // arguments are not consumed anymore
+    EXPECT_EQ(args.size(), 5);
+
+    args = {"one", "two", "-o"};
+    try {
+        sut.parse_vector(args);
+        FAIL();
+    } catch (argcpp17_exception& e) {
+        EXPECT_EQ(e.error(), argcpp17_exception::err_missing_value);
+    }
+
+    args = {"one", "two", "three"};
+    try {
+        sut.parse_vector(args);
+        FAIL();
+    } catch (argcpp17_exception& e) {
+        EXPECT_EQ(e.error(), argcpp17_exception::err_unknown_arguments);
+    }
+}
+
+TEST_F(parser_test, parse_many_positionals)
+{
+    static const size_t COUNT = 50000;
+    std::vector<std::string> args;
+    for (size_t i = 0; i < COUNT; i++) {
+        sut.add_positional("pos" + std::to_string(i), DESC);
+        args.push_back("file" + std::to_string(i));
+    }
+
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    EXPECT_EQ(sut.get_value<std::string>({"pos0"}), "file0");
+}
+
+TEST_F(parser_test, parse_longest_option_match)
+{
+    std::vector<std::string> args;
+
+    sut.add_optional_argument({"o"}, DESC)
+       .add_optional_argument({"out", "x"}, DESC);
+    EXPECT_EQ(sut.ambiguous_options(), std::vector<std::string>({ "--o" }));
+
+    args = {"--output"};
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    EXPECT_EQ(sut.get_value<std::string>({"out"}), "put");
+    EXPECT_FALSE(sut.get_value<std::string>({"o"}).has_value());
+
+    args = {"--o=ut", "-x:file"};
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    EXPECT_EQ(sut.get_value<std::string>({"o"}), "ut");
+    EXPECT_EQ(sut.get_value<std::string>({"out"}), "file");
+
+    // already normalized keys are not prefixed twice
+    EXPECT_THROW(sut.add_optional_argument({"--out"}, DESC), argcpp17_exception);
+}
+
+inline constexpr static_keyword STATIC_VERBOSE = {"verbose", "v"};
+inline constexpr static_keyword STATIC_THREADS = {"threads", "t"};
+inline constexpr static_keyword STATIC_NAME = {"name", "n"};
+inline constexpr static_keyword STATIC_INPUT = {"input", {}};
+inline constexpr static_keyword STATIC_VERY = {"very", "v"};
+
+inline constexpr static_keyword STATIC_OUT = {"out", {}};
+inline constexpr static_keyword STATIC_DASHED_OUT = {"-out", {}};
+
+// duplicate keys or abbreviations fail to compile, also between flags and options and after adding dashes
+static_assert(!static_keys_unique<static_flag<STATIC_VERBOSE>, static_flag<STATIC_VERY>>());
+static_assert(!static_keys_unique<static_optional<STATIC_NAME, int>, static_mandatory<STATIC_NAME, int>>());
+static_assert(!static_keys_unique<static_flag<STATIC_VERBOSE>, static_optional<STATIC_VERY, int>>());
+static_assert(!static_keys_unique<static_flag<STATIC_NAME>, static_optional<STATIC_NAME, int>>());
+static_assert(!static_keys_unique<static_optional<STATIC_OUT, int>, static_optional<STATIC_DASHED_OUT, int>>());
+// positional names may repeat
+static_assert(static_keys_unique<static_flag<STATIC_VERBOSE>, static_optional<STATIC_THREADS, int>,
+                                 static_positional<STATIC_INPUT>, static_positional<STATIC_INPUT>>());
+
+class static_parser_test : public ::testing::Test {
+public:
+    using verbose = static_flag<STATIC_VERBOSE>;
+    using threads = static_optional<STATIC_THREADS, int>;
+    using name = static_mandatory<STATIC_NAME, std::string>;
+    using input = static_positional<STATIC_INPUT, std::string_view>;
+
+    class derived_static_parser : public static_parser<verbose, threads, name, input>
+    {
+    public:
+        using static_parser::parse_vector;
+        using static_parser::try_parse;
+    };
+
+protected:
+    derived_static_parser sut;
+};
+
+TEST_F(static_parser_test, parse)
+{
+    std::vector<std::string> args;
+
+    args = {"v", "--threads=8", "-nfoo", "file"};
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    EXPECT_TRUE(sut.get<verbose>());
+    EXPECT_EQ(sut.get<threads>(), 8);
+    EXPECT_EQ(sut.get<name>(), "foo");
+    EXPECT_EQ(sut.get<input>(), "file");
+    EXPECT_TRUE(sut.is_parsed<name>());
+
+    args = {"--name", "bar", "file"};
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    EXPECT_FALSE(sut.get<verbose>());
+    EXPECT_FALSE(sut.get<threads>().has_value());
+    EXPECT_FALSE(sut.is_parsed<threads>());
+    EXPECT_EQ(sut.get<name>(), "bar");
+
+    args = {"file"};
+    EXPECT_THROW(sut.parse_vector(args), argcpp17_exception);
+
+    args = {"-n", "foo"};
+    EXPECT_THROW(sut.parse_vector(args), argcpp17_exception);
+
+    args = {"-n", "foo", "file", "another_file"};
+    EXPECT_THROW(sut.parse_vector(args), argcpp17_exception);
+
+    args = {"file", "-n"};
+    EXPECT_THROW(sut.parse_vector(args), argcpp17_exception);
+}
+
+TEST_F(static_parser_test, keyword_compatibility)
+{
+    parser p;
+    p.add_flag(STATIC_VERBOSE, DESC)
+     .add_optional_argument(STATIC_THREADS, DESC);
+
+    EXPECT_EQ(p.flags(), 1);
+    EXPECT_EQ(p.optionals(), 1);
+    EXPECT_THROW(p.add_flag({std::string(STATIC_THREADS.key)}, DESC), argcpp17_exception);
+}
+
+TEST_F(parser_test, parse_typed_values)
+{
+    std::vector<std::string> args;
+
+    sut.add_optional_argument<int>({"threads", "t"}, DESC)
+       .add_mandatory_argument<test_color>({"color", "c"}, DESC)
+       .add_positional<byte_size>("size", DESC);
+
+    args = {"-t8", "--color", "blue", "4KiB"};
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    EXPECT_EQ(sut.get_value<int>({"threads"}), 8);
+    EXPECT_EQ(sut.get_value<test_color>({"c"}), blue);
+    EXPECT_EQ(sut.get_value<byte_size>({"size"}).value(), 4096u);
+    // other types are still converted on demand
+    EXPECT_EQ(sut.get_value<std::string>({"threads"}), "8");
+
+    // typed arguments report invalid values while parsing
+    args = {"-tmany", "--color", "blue", "4KiB"};
+    try {
+        sut.parse_vector(args);
+        FAIL();
+    } catch (argcpp17_exception& e) {
+        EXPECT_EQ(e.error(), argcpp17_exception::err_invalid_value);
+    }
+
+    args = {"--color", "blue", "4KiB"};
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    EXPECT_FALSE(sut.get_value<int>({"threads"}).has_value());
+}
+
+TEST_F(parser_test, prepared_parse)
+{
+    sut.add_flag({"flag", "f"}, DESC)
+       .add_optional_argument<int>({"threads", "t"}, DESC)
+       .add_mandatory_argument({"name", "n"}, DESC)
+       .add_positional("input", DESC);
+    sut.add_subcommand("sub", DESC)
+       .add_mandatory_argument({"value", "v"}, DESC);
+
+    auto prepared = sut.prepare();
+    EXPECT_EQ(prepared.subcommands(), 1);
+    EXPECT_EQ(prepared.flags(), 1);
+    EXPECT_EQ(prepared.optionals(), 1);
+
+    parse_result result;
+    std::vector<std::string> args = {"f", "-t", "4", "--name=foo", "file"};
+    EXPECT_TRUE(prepared.parse(args.begin(), args.end(), result));
+    EXPECT_TRUE(result.ok());
+    EXPECT_TRUE(result.get_flag({"f"}));
+    EXPECT_EQ(result.get_value<int>({"threads"}), 4);
+    EXPECT_EQ(result.get_value<std::string_view>({"name"}), "foo");
+    EXPECT_EQ(result.get_value<std::string>({"input"}), "file");
+    EXPECT_EQ(result.subcommand(), parse_result::npos);
+
+    args = {"-n", "foo", "file", "another_file"};
+    EXPECT_FALSE(prepared.parse(args.begin(), args.end(), result));
+    EXPECT_EQ(result.error(), argcpp17_exception::err_unknown_arguments);
+    EXPECT_EQ(result.error_index(), 3);
+    EXPECT_FALSE(result.get_flag({"f"}));
+
+    args = {"-n", "foo", "-tx", "file"};
+    EXPECT_FALSE(prepared.parse(args.begin(), args.end(), result));
+    EXPECT_EQ(result.error(), argcpp17_exception::err_invalid_value);
+    EXPECT_EQ(result.error_index(), 2);
+
+    args = {"sub", "-v", "1"};
+    EXPECT_TRUE(prepared.parse(args.begin(), args.end(), result));
+    ASSERT_NE(result.get_subcommand({"sub"}), nullptr);
+    EXPECT_EQ(result.get_subcommand({"sub"})->get_value<int>({"v"}), 1);
+
+    args = {"sub", "-v"};
+    EXPECT_FALSE(prepared.parse(args.begin(), args.end(), result));
+    EXPECT_EQ(result.error(), argcpp17_exception::err_missing_value);
+    EXPECT_EQ(result.error_index(), 1);
+}
+
+TEST_F(parser_test, prepared_reparse_without_allocation)
+{
+    sut.add_flag({"flag", "f"}, DESC)
+       .add_optional_argument<int>({"threads", "t"}, DESC)
+       .add_positional("input", DESC);
+    sut.add_subcommand("sub", DESC)
+       .add_flag({"flag", "f"}, DESC);
+
+    auto prepared = sut.prepare();
+    parse_result result;
+
+    char app[] = "app", flag[] = "f", threads[] = "-t8", input[] = "file", sub[] = "sub";
+    char* args[] = { app, flag, threads, input };
+    char* sub_args[] = { app, sub, flag };
+
+    // warm up buffers
+    EXPECT_TRUE(prepared.parse(4, args, result));
+    EXPECT_TRUE(prepared.parse(3, sub_args, result));
+
+    size_t before = allocations;
+    for (int i = 0; i < 100; i++) {
+        EXPECT_TRUE(prepared.parse(4, args, result));
+        EXPECT_TRUE(prepared.parse(3, sub_args, result));
+        EXPECT_FALSE(prepared.parse(3, args, result));
+    }
+    EXPECT_EQ(allocations, before);
+}
+
+TEST_F(parser_test, parse_after_schema_change)
+{
+    std::vector<std::string> args;
+
+    auto& sub = sut.add_subcommand(KEY, DESC);
+    args = {KEY};
+    EXPECT_NO_THROW(sut.parse_vector(args));
+
+    // changes of sub parsers are picked up as well
+    sut.get_subcommand_parser({KEY}).add_flag({"flag"}, DESC);
+    args = {KEY, "flag"};
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    EXPECT_TRUE(sut.get_subcommand_parser({KEY}).get_flag({"flag"}));
+    (void) sub;
+}
+
+TEST_F(parser_test, try_parse)
+{
+    std::vector<std::string> args;
+
+    sut.add_mandatory_argument<int>({"threads", "t"}, DESC)
+       .add_flag({"flag", "f"}, DESC)
+       .add_positional("input", DESC);
+    sut.add_subcommand("sub", DESC)
+       .add_flag({"flag", "f"}, DESC);
+
+    args = {"-t", "4", "file"};
+    EXPECT_TRUE(sut.try_parse_vector(args));
+    EXPECT_EQ(sut.get_value<int>({"threads"}), 4);
+
+    args = {"-tx", "file"};
+    auto status = sut.try_parse_vector(args);
+    EXPECT_FALSE(status);
+    EXPECT_EQ(status.error, argcpp17_exception::err_invalid_value);
+    EXPECT_EQ(status.index, 0);
+
+    args = {"-t1", "file", "unknown"};
+    status = sut.try_parse_vector(args);
+    EXPECT_EQ(status.error, argcpp17_exception::err_unknown_arguments);
+    EXPECT_EQ(status.index, 2);
+
+    args = {"f", "file"};
+    status = sut.try_parse_vector(args);
+    EXPECT_EQ(status.error, argcpp17_exception::err_missing_mandatory);
+
+    args = {"-t1", "-t"};
+    status = sut.try_parse_vector(args);
+    EXPECT_EQ(status.error, argcpp17_exception::err_missing_value);
+    EXPECT_EQ(status.index, 1);
+
+    // the throwing interface reports the same error
+    EXPECT_THROW(sut.parse_vector(args), argcpp17_exception);
+
+    EXPECT_NE(sut.find_subcommand_parser({"sub"}), nullptr);
+    EXPECT_EQ(sut.find_subcommand_parser({"none"}), nullptr);
+    EXPECT_THROW(sut.get_subcommand_parser({"none"}), argcpp17_exception);
+}
+
+TEST_F(static_parser_test, try_parse)
+{
+    char app[] = "app", name[] = "--name=foo", threads[] = "-tx", input[] = "file";
+    char* args[] = { app, name, threads, input };
+
+    auto status = sut.try_parse(4, args);
+    EXPECT_FALSE(status);
+    EXPECT_EQ(status.error, argcpp17_exception::err_invalid_value);
+    EXPECT_EQ(status.index, 1);
+
+    char* missing[] = { app, name };
+    EXPECT_EQ(sut.try_parse(2, missing).error, argcpp17_exception::err_missing_positionals);
+
+    char* valid[] = { app, name, input };
+    EXPECT_TRUE(sut.try_parse(3, valid));
+    EXPECT_EQ(sut.get<static_parser_test::input>(), "file");
+}
+
+TEST_F(parser_test, shared_schema_across_threads)
+{
+    sut.add_flag({"flag", "f"}, DESC)
+       .add_optional_argument<int>({"threads", "t"}, DESC)
+       .add_positional("input", DESC);
+    sut.add_subcommand("sub", DESC)
+       .add_mandatory_argument<int>({"value", "v"}, DESC);
+
+    auto schema = sut.shared_schema();
+    EXPECT_EQ(sut.shared_schema(), schema);
+
+    std::atomic<size_t> failures{0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 8; t++) {
+        workers.emplace_back([&schema, &failures, t] {
+            // every worker owns its result, the schema is only read
+            parse_result result;
+            auto threads = std::to_string(t);
+            auto value = "-v" + std::to_string(t * 10);
+            std::vector<std::string_view> args = {"f", "-t", threads, "file"};
+            std::vector<std::string_view> sub_args = {"sub", value};
+            for (int i = 0; i < 1000; i++) {
+                if (!schema->parse(args.begin(), args.end(), result) || result.get_value<int>({"threads"}) != t || !result.get_flag({"flag"}))
+                    failures++;
+                if (!schema->parse(sub_args.begin(), sub_args.end(), result) || result.subcommand_result()->get_value<int>({"value"}) != t * 10)
+                    failures++;
+            }
+        });
+    }
+    for (auto& worker : workers)
+        worker.join();
+    EXPECT_EQ(failures, 0);
+
+    // schema changes produce a new schema, workers keep the old one alive
+    sut.add_flag({"other"}, DESC);
+    EXPECT_NE(sut.shared_schema(), schema);
+    EXPECT_EQ(schema->flags(), 1);
+}
+
+static std::string write_response_file(const std::string& name, const std::string& content)
+{
+    auto path = ::testing::TempDir() + name;
+    std::ofstream(path, std::ios::binary) << content;
+    return path;
+}
+
+template<typename It>
+static std::vector<std::string> expand_tokens(response_expander<It>& expander)
+{
+    std::vector<std::string> tokens;
+    for (auto token : expander)
+        tokens.emplace_back(token);
+    return tokens;
+}
+
+TEST(response_expander_test, tokenize)
+{
+    auto path = write_response_file("argcpp17_tokenize.rsp", "  plain\t'single \\ quoted' \"double \\\" quoted\"\n"
+                                                             "escaped\\ space '' '@literal' last");
+    std::vector<std::string> args = {"first", "@" + path, "after"};
+    std::vector<std::shared_ptr<response_file>> files;
+    response_expander expander(args.begin(), args.end(), files);
+
+    auto tokens = expand_tokens(expander);
+    std::vector<std::string> expected = {"first", "plain", "single \\ quoted", "double \" quoted", "escaped space", "", "@literal", "last", "after"};
+    EXPECT_EQ(tokens, expected);
+    EXPECT_TRUE(expander.status());
+    EXPECT_EQ(files.size(), 1);
+}
+
+TEST(response_expander_test, nested)
+{
+    auto inner = write_response_file("argcpp17_inner.rsp", "b c");
+    auto outer = write_response_file("argcpp17_outer.rsp", "a @" + inner + " d");
+    std::vector<std::string> args = {"@" + outer};
+    std::vector<std::shared_ptr<response_file>> files;
+
+    response_expander expander(args.begin(), args.end(), files);
+    auto tokens = expand_tokens(expander);
+    EXPECT_EQ(tokens, std::vector<std::string>({"a", "b", "c", "d"}));
+
+    // outer file is the first level already
+    response_expander shallow(args.begin(), args.end(), files, 1);
+    tokens = expand_tokens(shallow);
+    EXPECT_EQ(tokens, std::vector<std::string>({"a"}));
+    EXPECT_EQ(shallow.status().error, argcpp17_exception::err_response_file_depth);
+    EXPECT_EQ(shallow.status().index, 1);
+
+    auto recursive = write_response_file("argcpp17_recursive.rsp", "x @" + ::testing::TempDir() + "argcpp17_recursive.rsp");
+    args = {"@" + recursive};
+    response_expander endless(args.begin(), args.end(), files);
+    tokens = expand_tokens(endless);
+    EXPECT_EQ(tokens.size(), response_expander<std::vector<std::string>::iterator>::default_depth);
+    EXPECT_EQ(endless.status().error, argcpp17_exception::err_response_file_depth);
+}
+
+TEST_F(parser_test, parse_response_file)
+{
+    auto path = write_response_file("argcpp17_parse.rsp", "f --threads=4 \"input file\"");
+    std::vector<std::string> args = {"@" + path};
+
+    sut.add_flag({"flag", "f"}, DESC)
+       .add_optional_argument<int>({"threads", "t"}, DESC)
+       .add_positional("input", DESC);
+
+    // disabled by default
+    EXPECT_TRUE(sut.try_parse_vector(args));
+    EXPECT_EQ(sut.get_value<std::string>({"input"}), args[0]);
+
+    sut.enable_response_files();
+    EXPECT_TRUE(sut.try_parse_vector(args));
+    EXPECT_TRUE(sut.get_flag({"flag"}));
+    EXPECT_EQ(sut.get_value<int>({"threads"}), 4);
+    EXPECT_EQ(sut.get_value<std::string>({"input"}), "input file");
+
+    args = {"@" + ::testing::TempDir() + "argcpp17_missing.rsp"};
+    auto status = sut.try_parse_vector(args);
+    EXPECT_EQ(status.error, argcpp17_exception::err_response_file);
+    EXPECT_EQ(status.index, 0);
+
+    // tokens before a failing response file are not applied
+    args = {"--threads=8", "@" + ::testing::TempDir() + "argcpp17_missing.rsp"};
+    status = sut.try_parse_vector(args);
+    EXPECT_EQ(status.error, argcpp17_exception::err_response_file);
+    EXPECT_EQ(status.index, 1);
+    EXPECT_EQ(sut.get_value<int>({"threads"}), 4);
+    EXPECT_TRUE(sut.get_flag({"flag"}));
+}
+
+TEST_F(parser_test, parse_repeated_arguments)
+{
+    std::vector<std::string> args;
+
+    sut.add_repeated_argument<int>({"include", "I"}, DESC)
+       .add_optional_argument({"out", "o"}, DESC)
+       .add_positional("input", DESC);
+
+    args = {"-I1", "file", "-o", "a", "--include", "2", "-o", "b", "-I:3"};
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    auto values = sut.get_values({"include"});
+    ASSERT_EQ(values.size(), 3);
+    EXPECT_EQ(values[0], "1");
+    EXPECT_EQ(values[1], "2");
+    EXPECT_EQ(values.value<int>(2), 3);
+    // single valued access returns the last occurrence
+    EXPECT_EQ(sut.get_value<int>({"I"}), 3);
+    EXPECT_EQ(sut.get_value<std::string>({"out"}), "b");
+    EXPECT_TRUE(sut.get_values({"out"}).empty());
+
+    // every occurrence is converted
+    args = {"-I1", "file", "-Ix"};
+    EXPECT_EQ(sut.try_parse_vector(args).error, argcpp17_exception::err_invalid_value);
+
+    args = {"file"};
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    EXPECT_TRUE(sut.get_values({"include"}).empty());
+}
+
+TEST_F(parser_test, parse_positional_list)
+{
+    std::vector<std::string> args;
+
+    sut.add_flag({"flag", "f"}, DESC)
+       .add_positional("output", DESC)
+       .add_positional_list("inputs", DESC);
+    EXPECT_THROW(sut.add_positional("other", DESC), argcpp17_exception);
+
+    args = {"out"};
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    EXPECT_TRUE(sut.get_values({"inputs"}).empty());
+
+    args = {};
+    EXPECT_EQ(sut.try_parse_vector(args).error, argcpp17_exception::err_missing_positionals);
+
+    args = {"out", "a", "f", "b", "c"};
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    EXPECT_TRUE(sut.get_flag({"flag"}));
+    EXPECT_EQ(sut.get_value<std::string>({"output"}), "out");
+    std::vector<std::string_view> inputs(sut.get_values({"inputs"}).begin(), sut.get_values({"inputs"}).end());
+    EXPECT_EQ(inputs, std::vector<std::string_view>({"a", "b", "c"}));
+}
+
+TEST_F(parser_test, prepared_positional_list_without_allocation)
+{
+    sut.add_repeated_argument({"define", "D"}, DESC)
+       .add_positional_list("inputs", DESC);
+
+    std::vector<std::string> args;
+    for (size_t i = 0; i < 100000; i++)
+        args.push_back(i % 10 ? "file" + std::to_string(i) : "-Dkey" + std::to_string(i));
+
+    auto prepared = sut.prepare();
+    parse_result result;
+    EXPECT_TRUE(prepared.parse(args.begin(), args.end(), result));
+
+    size_t before = allocations;
+    EXPECT_TRUE(prepared.parse(args.begin(), args.end(), result));
+    EXPECT_EQ(allocations, before);
+
+    auto inputs = result.get_values({"inputs"});
+    auto defines = result.get_values({"D"});
+    ASSERT_EQ(inputs.size(), 90000);
+    ASSERT_EQ(defines.size(), 10000);
+    EXPECT_EQ(inputs[0], "file1");
+    EXPECT_EQ(inputs[inputs.size() - 1], "file99999");
+    EXPECT_EQ(defines[1], "key10");
+}
+
+TEST_F(parser_test, parse_lazy)
+{
+    sut.add_flag({"flag", "f"}, DESC)
+       .add_optional_argument<int>({"threads", "t"}, DESC)
+       .add_positional("command", DESC)
+       .add_positional_list<int>("numbers", DESC);
+    sut.add_subcommand("sub", DESC)
+       .add_flag({"flag", "f"}, DESC);
+
+    char app[] = "app", flag[] = "f", threads[] = "-t4", command[] = "run", number[] = "x", separator[] = "--", sub[] = "sub";
+
+    // the tail is not converted, so the invalid number is no error
+    char* args[] = { app, flag, command, number, threads };
+    auto rest = sut.parse_lazy(5, args);
+    EXPECT_TRUE(sut.get_flag({"flag"}));
+    EXPECT_EQ(sut.get_value<std::string>({"command"}), "run");
+    EXPECT_FALSE(sut.get_value<int>({"threads"}).has_value());
+    ASSERT_EQ(std::distance(rest.begin(), rest.end()), 2);
+    EXPECT_EQ(rest.first, &args[3]);
+
+    // separator ends option parsing and is skipped
+    char* separated[] = { app, threads, command, separator, flag };
+    rest = sut.parse_lazy(5, separated);
+    EXPECT_EQ(sut.get_value<int>({"threads"}), 4);
+    EXPECT_FALSE(sut.get_flag({"flag"}));
+    ASSERT_EQ(std::distance(rest.begin(), rest.end()), 1);
+    EXPECT_EQ(*rest.first, flag);
+
+    // declared positionals are still required
+    char* missing[] = { app, separator, command };
+    token_range<char**> tail;
+    EXPECT_EQ(sut.try_parse_lazy(3, missing, tail).error, argcpp17_exception::err_missing_positionals);
+
+    char* sub_args[] = { app, sub, flag, command, flag };
+    rest = sut.parse_lazy(5, sub_args);
+    EXPECT_TRUE(sut.get_subcommand_parser({"sub"}).get_flag({"flag"}));
+    EXPECT_EQ(rest.first, &sub_args[3]);
+
+    // without lazy parsing the whole command line is parsed
+    EXPECT_EQ(sut.try_parse(5, args).error, argcpp17_exception::err_invalid_value);
+}
+
+TEST_F(parser_test, prepared_parse_lazy)
+{
+    sut.add_flag({"flag", "f"}, DESC);
+
+    std::vector<std::string> args = {"f", "a", "b", "c"};
+    auto prepared = sut.prepare();
+    parse_result result;
+    token_range<std::vector<std::string>::iterator> rest;
+    EXPECT_TRUE(prepared.parse_lazy(args.begin(), args.end(), result, rest));
+    EXPECT_TRUE(result.get_flag({"flag"}));
+    EXPECT_EQ(rest.begin(), args.begin() + 1);
+    EXPECT_EQ(rest.end(), args.end());
+
+    args = {"f"};
+    EXPECT_TRUE(prepared.parse_lazy(args.begin(), args.end(), result, rest));
+    EXPECT_TRUE(rest.empty());
+}
+
+TEST_F(parser_test, prepared_parse_with_memory_resource)
+{
+    sut.add_flag({"flag", "f"}, DESC)
+       .add_optional_argument<int>({"threads", "t"}, DESC)
+       .add_repeated_argument({"include", "I"}, DESC)
+       .add_positional("input", DESC);
+    sut.add_subcommand("sub", DESC)
+       .add_flag({"flag", "f"}, DESC);
+
+    std::vector<std::string> args = {"f", "-t4", "-Ia", "-Ib", "file"};
+    std::vector<std::string> sub_args = {"sub", "f"};
+
+    // schema and results live in the arena, running out of it would throw
+    alignas(std::max_align_t) static char buffer[64 * 1024];
+    std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+    {
+        auto schema = sut.prepare(&arena);
+        parse_result result(&arena);
+        EXPECT_TRUE(schema.parse(args.begin(), args.end(), result));
+        EXPECT_EQ(result.get_value<int>({"threads"}), 4);
+        EXPECT_EQ(result.get_values({"include"}).size(), 2);
+
+        EXPECT_TRUE(schema.parse(sub_args.begin(), sub_args.end(), result));
+        ASSERT_NE(result.subcommand_result(), nullptr);
+        EXPECT_TRUE(result.subcommand_result()->get_flag({"flag"}));
+        EXPECT_EQ(result.subcommand_result()->get_allocator().resource(), &arena);
+
+        // copies use the default resource unless one is given
+        parse_result copy(result);
+#if defined(ARGCPP17_ENABLE_STATS)
+        EXPECT_EQ(copy.get_allocator().resource(), statistics_resource());
+#else
+        EXPECT_EQ(copy.get_allocator().resource(), std::pmr::get_default_resource());
+#endif
+    }
+
+    size_t before = allocations;
+    {
+        auto schema = sut.prepare(&arena);
+        parse_result result(&arena);
+        EXPECT_TRUE(schema.parse(args.begin(), args.end(), result));
+        EXPECT_TRUE(schema.parse(sub_args.begin(), sub_args.end(), result));
+    }
+    EXPECT_EQ(allocations, before);
+    // everything of the parse is freed at once
+    arena.release();
+}
+
+TEST_F(parser_test, subcommand_references_stay_valid)
+{
+    static_assert(std::is_nothrow_move_constructible_v<keyword>);
+    static_assert(std::is_nothrow_move_constructible_v<optional_argument>);
+    static_assert(std::is_nothrow_move_constructible_v<subcommand<parser>>);
+
+    auto& first = sut.add_subcommand("first", DESC);
+    for (int i = 0; i < 300; i++)
+        sut.add_subcommand("sub" + std::to_string(i), DESC);
+    // the vector of subcommands was reallocated several times
+    first.add_flag({"flag", "f"}, DESC);
+    EXPECT_EQ(&first, &sut.get_subcommand_parser({"first"}));
+
+    std::vector<std::string> args = {"first", "f"};
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    EXPECT_TRUE(first.get_flag({"flag"}));
+
+    // copies own their sub parsers
+    derived_parser copy(sut);
+    copy.get_subcommand_parser({"first"}).add_flag({"other"}, DESC);
+    EXPECT_EQ(copy.get_subcommand_parser({"first"}).flags(), 2);
+    EXPECT_EQ(first.flags(), 1);
+}
+
+TEST_F(parser_test, help)
+{
+    sut.add_subcommand("build", "build the project");
+    sut.add_mandatory_argument({"name", "n"}, "name of the thing")
+       .add_optional_argument({"threads", "t"}, "number of worker threads used while building the project, defaults to the number of cores")
+       .add_repeated_argument({"include", "I"}, "include directory")
+       .add_flag({"verbose", "v"}, "verbose output")
+       .add_positional_list("inputs", "input files");
+
+    auto text = sut.help("app");
+    EXPECT_EQ(text,
+        "app [sub-command] <mandatory_options> [options/flags] inputs...\n"
+        "\n"
+        "sub-commands:\n"
+        "  build                     build the project\n"
+        "mandatory options:\n"
+        "  --name, -n <value>        name of the thing\n"
+        "options:\n"
+        "  --threads, -t <value>     number of worker threads used while building the\n"
+        "                            project, defaults to the number of cores\n"
+        "  --include, -I <value>...  include directory\n"
+        "flags:\n"
+        "  verbose, v                verbose output\n"
+        "positional arguments:\n"
+        "  inputs...                 input files\n");
+
+    // cached until the schema changes
+    size_t before = allocations;
+    EXPECT_EQ(sut.help("app").data(), text.data());
+    EXPECT_EQ(allocations, before);
+
+    sut.add_flag({"quiet", "q"}, "no output");
+    EXPECT_NE(sut.help("app").find("  quiet, q                  no output\n"), std::string_view::npos);
+
+    testing::internal::CaptureStdout();
+    sut.usage("app");
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), sut.help("app"));
+}
+
+TEST_F(parser_test, help_wrapping)
+{
+    sut.add_flag({"a-very-long-flag-name-exceeding-half-the-width"}, "description on its own line")
+       .add_flag({"f"}, "short");
+
+    std::string text(sut.help("app", 60));
+    EXPECT_NE(text.find("  a-very-long-flag-name-exceeding-half-the-width\n"
+                        "                              description on its own line\n"), std::string::npos);
+    EXPECT_NE(text.find("  f                           short\n"), std::string::npos);
+}
+
+TEST_F(parser_test, complete_keywords)
+{
+    sut.add_flag({"verbose", "v"}, "verbose output")
+       .add_optional_argument({"threads", "t"}, "threads")
+       .add_optional_argument({"-output"}, "output");
+    auto& sub = sut.add_subcommand({"test"}, "test command");
+    sub.add_flag({"trace"}, "trace");
+
+    EXPECT_EQ(sut.complete({"t"}), (std::vector<std::string>{"test"}));
+    EXPECT_EQ(sut.complete({"v", "t"}), (std::vector<std::string>{}));
+    EXPECT_EQ(sut.complete({"v", "-"}), (std::vector<std::string>{"--output", "--threads", "-t"}));
+    EXPECT_EQ(sut.complete({"--t"}), (std::vector<std::string>{"--threads"}));
+    EXPECT_EQ(sut.complete({"test", "t"}), (std::vector<std::string>{"trace"}));
+    // a key with one dash is completed and matched with two
+    std::vector<std::string> args = {"--output", "file"};
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    EXPECT_EQ(sut.get_value<std::string>({"-output"}), "file");
+}
+
+TEST_F(parser_test, complete_values)
+{
+    sut.add_optional_argument({"mode"}, "mode")
+       .add_positional("input", "input file");
+    sut.set_completer({"mode"}, [](std::string_view, std::vector<std::string>& candidates) {
+        candidates.insert(candidates.end(), {"fast", "full", "safe"});
+    });
+    sut.set_completer({"input"}, [](std::string_view, std::vector<std::string>& candidates) {
+        candidates.push_back("input.txt");
+    });
+
+    EXPECT_EQ(sut.complete({"--mode", "f"}), (std::vector<std::string>{"fast", "full"}));
+    EXPECT_EQ(sut.complete({"--mode=s"}), (std::vector<std::string>{"--mode=safe"}));
+    EXPECT_EQ(sut.complete({"i"}), (std::vector<std::string>{"input.txt"}));
+    EXPECT_EQ(sut.complete({"input.txt", "i"}), (std::vector<std::string>{}));
+    EXPECT_THROW(sut.set_completer({"missing"}, nullptr), argcpp17_exception);
+}
+
+TEST_F(parser_test, bash_completion)
+{
+    sut.add_flag({"verbose"}, "verbose output");
+    sut.add_subcommand({"test"}, "test command").add_flag({"trace"}, "trace");
+
+    auto script = sut.bash_completion("my-app");
+    EXPECT_NE(script.find("_my_app_complete()"), std::string::npos);
+    EXPECT_NE(script.find("\"\") words=\"test verbose\";;"), std::string::npos);
+    EXPECT_NE(script.find("\"/test\") words=\"trace\";;"), std::string::npos);
+    EXPECT_NE(script.find("complete -F _my_app_complete my-app"), std::string::npos);
+}
+
+TEST_F(parser_test, environment_and_config)
+{
+    ::setenv("ARGCPP17_TEST_PORT", "8080", 1);
+    ::setenv("ARGCPP17_TEST_HOST", "env-host", 1);
+    auto path = write_response_file("argcpp17_test.conf", "# service settings\n"
+                                                          "server.host = config-host\n"
+                                                          "server.threads=4\n"
+                                                          "\n"
+                                                          "server.threads = 16\n");
+    std::vector<std::string> args;
+
+    sut.add_mandatory_argument<int>({"port"}, DESC)
+       .add_optional_argument({"host"}, DESC)
+       .add_optional_argument<int>({"threads"}, DESC)
+       .bind_environment({"port"}, "ARGCPP17_TEST_PORT")
+       .bind_environment({"host"}, "ARGCPP17_TEST_HOST")
+       .bind_config({"host"}, "server.host")
+       .bind_config({"threads"}, "server.threads")
+       .load_config(path);
+
+    // the mandatory port is satisfied by the environment
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    EXPECT_EQ(sut.get_value<int>({"port"}), 8080);
+    EXPECT_EQ(sut.get_value<std::string>({"host"}), "env-host");
+    EXPECT_EQ(sut.get_value<int>({"threads"}), 16);
+
+    args = {"--port", "1", "--threads=2"};
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    EXPECT_EQ(sut.get_value<int>({"port"}), 1);
+    EXPECT_EQ(sut.get_value<int>({"threads"}), 2);
+
+    sut.set_config("server.threads", "many");
+    args = {};
+    EXPECT_THROW(sut.parse_vector(args), argcpp17_exception);
+
+    // variables are read again when the schema is prepared again
+    ::setenv("ARGCPP17_TEST_HOST", "new-host", 1);
+    sut.set_config("server.threads", "8");
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    EXPECT_EQ(sut.get_value<std::string>({"host"}), "new-host");
+    EXPECT_EQ(sut.get_value<int>({"threads"}), 8);
+
+    EXPECT_THROW(sut.bind_environment({"missing"}, "X"), argcpp17_exception);
+    EXPECT_THROW(sut.load_config(::testing::TempDir() + "argcpp17_missing.conf"), argcpp17_exception);
+}
+
+TEST_F(parser_test, statistics)
+{
+    std::vector<std::string> args = {"run", "v", "--threads", "4", "--name=x", "input"};
+    sut.add_subcommand({"build"}, DESC);
+    auto& run = sut.add_subcommand({"run"}, DESC);
+    run.add_flag({"verbose", "v"}, DESC)
+       .add_optional_argument<int>({"threads"}, DESC)
+       .add_optional_argument({"name"}, DESC)
+       .add_positional("input", DESC);
+
+    ASSERT_NO_THROW(sut.parse_vector(args));
+    auto& stats = sut.statistics();
+#if defined(ARGCPP17_ENABLE_STATS)
+    EXPECT_EQ(stats.tokens, args.size());
+    EXPECT_EQ(stats.conversions, 1);
+    EXPECT_EQ(stats.subcommand_path, std::vector<size_t>({1}));
+    EXPECT_GT(stats.allocations, 0);
+    EXPECT_GE(stats.allocated_bytes, stats.allocations);
+
+    // the schema and the result buffers are reused
+    ASSERT_NO_THROW(sut.parse_vector(args));
+    EXPECT_EQ(stats.tokens, args.size());
+    EXPECT_EQ(stats.allocations, 0);
+#else
+    EXPECT_EQ(stats.tokens, 0);
+    EXPECT_TRUE(stats.subcommand_path.empty());
+#endif
+}
+
+TEST_F(parser_test, statistics_copy_values)
+{
+    char app[] = "app";
+    char name[] = "--name=a value longer than the small string buffer";
+    char* args[] = { app, name };
+    sut.add_optional_argument({"name"}, DESC);
+
+    // the second view parse reuses the schema and the result buffers
+    ASSERT_NO_THROW(sut.parse(2, args, parser::view_values));
+    ASSERT_NO_THROW(sut.parse(2, args, parser::view_values));
+    auto views = sut.statistics();
+    ASSERT_NO_THROW(sut.parse(2, args, parser::copy_values));
+    auto& copies = sut.statistics();
+#if defined(ARGCPP17_ENABLE_STATS)
+    // the copy of the value is counted with the parse
+    EXPECT_EQ(views.allocations, 0);
+    EXPECT_GT(copies.allocations, 0);
+    EXPECT_GE(copies.allocated_bytes, std::string_view(name).substr(7).size());
+
+    // and reused by the next copy
+    ASSERT_NO_THROW(sut.parse(2, args, parser::copy_values));
+    EXPECT_EQ(copies.allocations, 0);
+#else
+    EXPECT_EQ(copies.allocations, views.allocations);
+#endif
+}
+
+TEST_F(parser_test, token_filters)
+{
+    std::vector<std::string> args = {"-q", "files", "--level=2", "verbose", "fast", "-l3", "quiet"};
+
+    sut.add_flag({"verbose", "-q"}, DESC)
+       .add_flag({"fast"}, DESC)
+       .add_optional_argument<int>({"level", "l"}, DESC)
+       .add_positional_list("files", DESC);
+
+    // dashed flags, flag names as long as positionals and positionals sharing a first character
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    EXPECT_TRUE(sut.get_flag({"verbose"}));
+    EXPECT_TRUE(sut.get_flag({"fast"}));
+    EXPECT_EQ(sut.get_value<int>({"level"}), 3);
+    auto files = sut.get_values({"files"});
+    ASSERT_EQ(files.size(), 2);
+    EXPECT_EQ(files[0], "files");
+    EXPECT_EQ(files[1], "quiet");
+}
+
+TEST_F(parser_test, deferred_subcommands)
+{
+    std::vector<std::string> args = {"build", "v", "--jobs", "4"};
+    size_t builds[3] = {};
+    for (size_t i = 0; i < 3; i++) {
+        auto name = std::vector<std::string>{"build", "test", "clean"}[i];
+        sut.add_subcommand(name, DESC, [&builds, i](parser& sub) {
+            builds[i]++;
+            sub.add_flag({"v"}, DESC)
+               .add_optional_argument<int>({"jobs"}, DESC);
+        });
+    }
+
+    // only the selected subcommand is built, and only once
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    EXPECT_EQ(builds[0], 1);
+    EXPECT_EQ(builds[1], 0);
+    EXPECT_EQ(builds[2], 0);
+    EXPECT_TRUE(sut.get_subcommand_parser({"build"}).get_flag({"v"}));
+    EXPECT_EQ(sut.get_subcommand_parser({"build"}).get_value<int>({"jobs"}), 4);
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    EXPECT_EQ(builds[0], 1);
+
+    // prepared schemas report deferred subcommands instead of building them
+    parse_result result;
+    auto schema = sut.prepare();
+    args = {"test", "v"};
+    EXPECT_FALSE(schema.parse(args.begin(), args.end(), result));
+    EXPECT_EQ(result.error(), argcpp17_exception::err_subcommand_deferred);
+    EXPECT_EQ(result.subcommand(), 1);
+    EXPECT_EQ(builds[1], 0);
+
+    // copies keep them deferred
+    auto copy = sut;
+    EXPECT_EQ(builds[2], 0);
+    EXPECT_EQ(sut.complete({"clean", "-"}), (std::vector<std::string>{"--jobs"}));
+    EXPECT_EQ(builds[2], 1);
+}
+
+TEST_F(parser_test, subcommand_dispatch)
+{
+    int jobs = 0;
+    sut.add_flag({"quiet"}, DESC)
+       .add_subcommand("build", DESC, [](parser& sub) {
+            sub.add_optional_argument<int>({"jobs"}, DESC);
+        }, [&jobs](parser& sub) {
+            jobs = sub.get_value<int>({"jobs"}).value_or(1);
+            return 3;
+        })
+       .add_subcommand("clean", DESC, nullptr);
+
+    char app[] = "app", build[] = "build", clean[] = "clean", option[] = "--jobs=8", quiet[] = "quiet";
+    char* build_args[] = {app, build, option};
+    EXPECT_EQ(sut.dispatch(3, build_args), 3);
+    EXPECT_EQ(jobs, 8);
+
+    char* clean_args[] = {app, clean};
+    EXPECT_FALSE(sut.dispatch(2, clean_args).has_value());
+    char* quiet_args[] = {app, quiet};
+    EXPECT_FALSE(sut.dispatch(2, quiet_args).has_value());
+}
+
+TEST_F(parser_test, short_option_clusters)
+{
+    sut.add_flag({"extract", "x"}, DESC)
+       .add_flag({"verbose", "v"}, DESC)
+       .add_optional_argument({"file", "f"}, DESC)
+       .add_positional_list("rest", DESC);
+
+    std::vector<std::string> args = {"-xvf", "out.tar"};
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    EXPECT_TRUE(sut.get_flag({"extract"}));
+    EXPECT_TRUE(sut.get_flag({"verbose"}));
+    EXPECT_EQ(sut.get_value<std::string>({"file"}), "out.tar");
+
+    // the option takes the rest of the token
+    args = {"-vfout.tar"};
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    EXPECT_FALSE(sut.get_flag({"extract"}));
+    EXPECT_TRUE(sut.get_flag({"verbose"}));
+    EXPECT_EQ(sut.get_value<std::string>({"file"}), "out.tar");
+
+    // unknown characters leave the token alone
+    args = {"-xq"};
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    EXPECT_FALSE(sut.get_flag({"extract"}));
+    ASSERT_EQ(sut.get_values({"rest"}).size(), 1);
+    EXPECT_EQ(*sut.get_values({"rest"}).begin(), "-xq");
+
+    args = {"-xf"};
+    EXPECT_EQ(sut.try_parse_vector(args).error, argcpp17_exception::err_missing_value);
+}
+
+TEST_F(parser_test, parse_batch)
+{
+    sut.add_flag({"verbose", "v"}, DESC)
+       .add_optional_argument<int>({"threads", "t"}, DESC)
+       .add_positional("input", DESC);
+
+    std::vector<std::vector<std::string>> lines;
+    for (int i = 0; i < 1000; i++)
+        if (i % 100 == 7)
+            lines.push_back({"-t", "x", "file"});
+        else
+            lines.push_back({"v", "-t", std::to_string(i), "file" + std::to_string(i)});
+
+    batch_result batch;
+    sut.parse_batch(lines.begin(), lines.end(), batch, 4);
+    ASSERT_EQ(batch.size(), lines.size());
+    EXPECT_EQ(batch.failures(), 10);
+    EXPECT_EQ(batch.ok[7], 0);
+    EXPECT_EQ(batch.errors[7], argcpp17_exception::err_invalid_value);
+    EXPECT_EQ(batch.error_indices[7], 1);
+    EXPECT_EQ(batch.ok[999], 1);
+    EXPECT_TRUE(batch.results[999].get_flag({"verbose"}));
+    EXPECT_EQ(batch.results[999].get_value<int>({"threads"}), 999);
+    EXPECT_EQ(batch.results[999].get_value<std::string>({"input"}), "file999");
+
+    // argv arrays, smaller batches reuse the results
+    char app[] = "app", flag[] = "v", input[] = "in";
+    char* args[] = {app, flag, input};
+    std::vector<token_range<char**>> argvs(3, token_range<char**>{&args[1], &args[3]});
+    auto schema = sut.prepare();
+    schema.parse_batch(argvs.begin(), argvs.end(), batch, 0);
+    ASSERT_EQ(batch.size(), 3);
+    EXPECT_EQ(batch.failures(), 0);
+    EXPECT_EQ(batch.results[2].get_value<std::string>({"input"}), "in");
+
+    // an exception of one line reaches the caller after the threads are joined
+    parser throwing;
+    throwing.add_optional_argument<throwing_value>({"value"}, DESC);
+    lines.assign(2000, {"--value", "ok"});
+    lines[1500] = {"--value", "throw"};
+    EXPECT_THROW(throwing.parse_batch(lines.begin(), lines.end(), batch, 4), std::runtime_error);
+}
+
+TEST_F(parser_test, schema_image_roundtrip)
+{
+    sut.add_flag({"verbose", "v"}, "more output")
+       .add_mandatory_argument<int>({"threads", "t"}, "worker threads")
+       .add_optional_argument<std::chrono::milliseconds>({"timeout"}, "timeout")
+       .add_repeated_argument({"define", "D"}, "definitions")
+       .add_positional("input", "input file");
+    sut.add_subcommand("sub", "a subcommand")
+       .add_flag({"flag", "f"}, DESC);
+    sut.add_subcommand("later", DESC, [](parser& sub) { sub.add_flag({"x"}, DESC); });
+
+    auto image = sut.prepare().save();
+    auto schema = prepared_parser::load(image);
+    EXPECT_EQ(schema.subcommands(), 2);
+    EXPECT_EQ(schema.flags(), 1);
+    EXPECT_EQ(schema.description({"threads"}), "worker threads");
+    EXPECT_EQ(schema.description({"input"}), "input file");
+    EXPECT_EQ(schema.description({"sub"}), "a subcommand");
+    EXPECT_EQ(schema.description({"missing"}), "");
+
+    parse_result result;
+    std::vector<std::string> args = {"-vt8", "--timeout=250ms", "-D", "a", "-Db", "in"};
+    EXPECT_TRUE(schema.parse(args.begin(), args.end(), result));
+    EXPECT_TRUE(result.get_flag({"verbose"}));
+    EXPECT_EQ(result.get_value<int>({"threads"}), 8);
+    EXPECT_EQ(result.get_value<std::chrono::milliseconds>({"timeout"}), std::chrono::milliseconds(250));
+    EXPECT_EQ(result.get_values({"define"}).size(), 2);
+    EXPECT_EQ(result.get_value<std::string>({"input"}), "in");
+
+    // converters are restored, so typed values are still validated while parsing
+    args = {"-t", "x", "in"};
+    EXPECT_FALSE(schema.parse(args.begin(), args.end(), result));
+    EXPECT_EQ(result.error(), argcpp17_exception::err_invalid_value);
+
+    args = {"sub", "f"};
+    EXPECT_TRUE(schema.parse(args.begin(), args.end(), result));
+    ASSERT_NE(result.get_subcommand({"sub"}), nullptr);
+    EXPECT_TRUE(result.get_subcommand({"sub"})->get_flag({"flag"}));
+
+    args = {"later", "x"};
+    EXPECT_FALSE(schema.parse(args.begin(), args.end(), result));
+    EXPECT_EQ(result.error(), argcpp17_exception::err_subcommand_deferred);
+
+    // loaded schemas save to the same image
+    EXPECT_EQ(schema.save(), image);
+    EXPECT_THROW(prepared_parser::load(std::string_view(image).substr(0, image.size() - 1)), argcpp17_exception);
+    EXPECT_THROW(prepared_parser::load("not an image"), argcpp17_exception);
+}
+
+TEST_F(parser_test, schema_image_deterministic)
+{
+    // padding is not saved, so equal schemas give equal images whatever memory they were built in
+    auto image = [](unsigned char garbage) {
+        std::vector<std::vector<unsigned char>> dirty(64, std::vector<unsigned char>(256, garbage));
+        dirty.clear();
+        parser p;
+        p.add_flag({"verbose", "v"}, DESC)
+         .add_optional_argument({"ratio", "r"}, DESC)
+         .add_range<double>({"ratio"}, 0, 1)
+         .add_positional("input", DESC);
+        return p.prepare().save();
+    };
+    EXPECT_EQ(image(0x00), image(0xff));
+}
+
+TEST_F(parser_test, schema_image_corrupt_tables)
+{
+    sut.add_optional_argument({"mode"}, DESC)
+       .add_choices({"mode"}, {"abcdefghij"});
+    auto image = sut.prepare().save();
+    EXPECT_NO_THROW(prepared_parser::load(image));
+
+    // the image ends with the choice {offset, length}, the choice names and no subcommands
+    auto names = image.size() - sizeof(uint32_t) - 10;
+    ASSERT_EQ(image.substr(names, 10), "abcdefghij");
+    uint32_t length = 11;
+    std::memcpy(&image[names - sizeof(uint32_t) - sizeof(length)], &length, sizeof(length));
+    EXPECT_THROW(prepared_parser::load(image), argcpp17_exception);
+}
+
+TEST_F(parser_test, option_handles)
+{
+    sut.add_flag({"verbose", "v"}, DESC)
+       .add_optional_argument<int>({"batch", "b"}, DESC)
+       .add_optional_argument({"name"}, DESC)
+       .add_positional("input", DESC);
+
+    auto verbose = sut.get_flag_handle({"verbose"});
+    auto batch = sut.get_handle<int>({"b"});
+    auto name = sut.get_handle<std::string>({"name"});
+    auto input = sut.get_handle<std::string_view>({"input"});
+    EXPECT_THROW(sut.get_handle<double>({"batch"}), argcpp17_exception);
+    EXPECT_THROW(sut.get_handle<int>({"missing"}), argcpp17_exception);
+    EXPECT_THROW(sut.get_flag_handle({"batch"}), argcpp17_exception);
+
+    // handles survive adding arguments
+    sut.add_flag({"quiet"}, DESC);
+
+    std::vector<std::string> args = {"v", "-b", "16", "--name=foo", "in"};
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    EXPECT_TRUE(verbose);
+    ASSERT_TRUE(batch);
+    EXPECT_EQ(*batch, 16);
+    EXPECT_EQ(*name, "foo");
+    EXPECT_EQ(name->size(), 3);
+    EXPECT_EQ(*input, "in");
+
+    // the untyped name argument is now validated as string, so nothing changes for it
+    args = {"in"};
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    EXPECT_FALSE(verbose);
+    EXPECT_FALSE(batch);
+    EXPECT_EQ(batch.get(), nullptr);
+
+    // the same handles read prepared results
+    parse_result result;
+    auto schema = sut.prepare();
+    args = {"-b", "4", "v", "file"};
+    EXPECT_TRUE(schema.parse(args.begin(), args.end(), result));
+    EXPECT_TRUE(result.get(verbose));
+    ASSERT_NE(result.get(batch), nullptr);
+    EXPECT_EQ(*result.get(batch), 4);
+    EXPECT_EQ(result.get(name), nullptr);
+    EXPECT_EQ(*result.get(input), "file");
+}
+
+TEST_F(parser_test, bound_variables)
+{
+    struct config {
+        bool verbose = false;
+        int threads = 1;
+        std::string name = "default";
+        std::chrono::milliseconds timeout{100};
+        std::vector<int> levels;
+        std::string input;
+        std::vector<std::string> files;
+    } cfg;
+
+    sut.add_flag({"verbose", "v"}, DESC, &cfg.verbose)
+       .add_optional_argument({"threads", "t"}, DESC, &cfg.threads)
+       .add_optional_argument({"name"}, DESC, &cfg.name)
+       .add_optional_argument({"timeout"}, DESC, &cfg.timeout)
+       .add_repeated_argument({"level", "l"}, DESC, &cfg.levels)
+       .add_positional("input", DESC, &cfg.input)
+       .add_positional_list("files", DESC, &cfg.files);
+
+    std::vector<std::string> args = {"v", "-t8", "--timeout=2s", "-l", "1", "-l3", "in", "a", "b"};
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    EXPECT_TRUE(cfg.verbose);
+    EXPECT_EQ(cfg.threads, 8);
+    EXPECT_EQ(cfg.name, "default");
+    EXPECT_EQ(cfg.timeout, std::chrono::seconds(2));
+    EXPECT_EQ(cfg.levels, (std::vector<int>{1, 3}));
+    EXPECT_EQ(cfg.input, "in");
+    EXPECT_EQ(cfg.files, (std::vector<std::string>{"a", "b"}));
+
+    // failed parses leave the variables alone
+    args = {"--name=other", "-t", "x", "in"};
+    EXPECT_EQ(sut.try_parse_vector(args).error, argcpp17_exception::err_invalid_value);
+    EXPECT_EQ(cfg.name, "default");
+    EXPECT_EQ(cfg.threads, 8);
+
+    args = {"--name=other", "in"};
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    EXPECT_EQ(cfg.name, "other");
+    EXPECT_EQ(cfg.files.size(), 2);
+
+    // bound lists take the values converted while parsing
+    std::vector<counted_value> counted;
+    sut.add_repeated_argument({"count", "c"}, DESC, &counted);
+    args = {"-c1", "-c2", "-c3", "in"};
+    counted_value::conversions = 0;
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    ASSERT_EQ(counted.size(), 3);
+    EXPECT_EQ(counted[2].value, "3");
+    EXPECT_EQ(counted_value::conversions, 3);
+
+    // bound arguments are still readable through get_value and handles
+    auto threads = sut.get_handle<int>({"threads"});
+    args = {"-t4", "in"};
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    EXPECT_EQ(cfg.threads, 4);
+    EXPECT_EQ(sut.get_value<int>({"threads"}), 4);
+    ASSERT_TRUE(threads);
+    EXPECT_EQ(*threads, 4);
+    EXPECT_EQ(sut.get_value<std::string>({"input"}), "in");
+
+    int port = 0;
+    parser service;
+    service.add_mandatory_argument({"port", "p"}, DESC, &port);
+    char app[] = "app", option[] = "-p80";
+    char* argv[] = {app, option};
+    EXPECT_NO_THROW(service.parse(2, argv));
+    EXPECT_EQ(port, 80);
+    EXPECT_EQ(service.get_value<int>({"port"}), 80);
+}
+
+TEST_F(parser_test, argument_constraints)
+{
+    sut.add_flag({"json"}, DESC)
+       .add_flag({"yaml"}, DESC)
+       .add_flag({"extract", "x"}, DESC)
+       .add_flag({"compress", "z"}, DESC)
+       .add_optional_argument({"user", "u"}, DESC)
+       .add_optional_argument({"password"}, DESC)
+       .add_optional_argument({"level", "l"}, DESC)
+       .add_optional_argument({"mode"}, DESC)
+       .add_positional("input", DESC);
+    sut.add_conflict({"json"}, {"yaml"})
+       .add_conflict({"extract"}, {"compress"})
+       .add_requirement({"password"}, {"user"})
+       .add_range<int>({"level"}, 1, 9)
+       .add_choices({"mode"}, {"fast", "safe"});
+    EXPECT_THROW(sut.add_conflict({"json"}, {"missing"}), argcpp17_exception);
+    EXPECT_THROW(sut.add_conflict({"extract"}, {"x"}), argcpp17_exception);
+
+    std::vector<std::string> args = {"json", "-u", "me", "--password=secret", "-l", "9", "--mode", "safe", "in"};
+    EXPECT_NO_THROW(sut.parse_vector(args));
+    EXPECT_EQ(sut.get_value<int>({"level"}), 9);
+
+    // the later of two conflicting arguments is reported, also inside clusters
+    args = {"in", "yaml", "-u", "me", "json"};
+    auto status = sut.try_parse_vector(args);
+    EXPECT_EQ(status.error, argcpp17_exception::err_conflicting_arguments);
+    EXPECT_EQ(status.index, 4);
+    args = {"-xz", "in"};
+    EXPECT_EQ(sut.try_parse_vector(args).error, argcpp17_exception::err_conflicting_arguments);
+
+    args = {"--password=secret", "in"};
+    EXPECT_EQ(sut.try_parse_vector(args).error, argcpp17_exception::err_missing_requirement);
+
+    args = {"in", "-l", "10"};
+    status = sut.try_parse_vector(args);
+    EXPECT_EQ(status.error, argcpp17_exception::err_invalid_value);
+    EXPECT_EQ(status.index, 2);
+    args = {"--mode=slow", "in"};
+    EXPECT_EQ(sut.try_parse_vector(args).error, argcpp17_exception::err_invalid_value);
+
+    // a NaN is outside of every range
+    sut.add_optional_argument({"ratio"}, DESC)
+       .add_range<double>({"ratio"}, 0, 1);
+    args = {"--ratio=nan", "in"};
+    EXPECT_EQ(sut.try_parse_vector(args).error, argcpp17_exception::err_invalid_value);
+    args = {"--ratio=0.5", "in"};
+    EXPECT_NO_THROW(sut.parse_vector(args));
+
+    // constraints are part of saved schemas
+    auto schema = prepared_parser::load(sut.prepare().save());
+    parse_result result;
+    args = {"-l0", "in"};
+    EXPECT_FALSE(schema.parse(args.begin(), args.end(), result));
+    EXPECT_EQ(result.error(), argcpp17_exception::err_invalid_value);
+    args = {"json", "--mode=fast", "yaml", "in"};
+    EXPECT_FALSE(schema.parse(args.begin(), args.end(), result));
+    EXPECT_EQ(result.error(), argcpp17_exception::err_conflicting_arguments);
+    args = {"--mode=fast", "-l5", "in"};
+    EXPECT_TRUE(schema.parse(args.begin(), args.end(), result));
+}
+
+TEST_F(parser_test, wide_arguments)
+{
+    sut.add_flag({"verbose", "v"}, DESC)
+       .add_optional_argument({"name", "n"}, DESC)
+       .add_positional_list("files", DESC);
+
+    wchar_t app[] = L"app.exe", flag[] = L"v", option[] = L"--name=gr\u00fc\u00dfe", file[] = L"\U0001F600.txt";
+    wchar_t* args[] = {app, flag, option, file};
+    EXPECT_NO_THROW(sut.parse(4, args, parser::view_values));
+    EXPECT_TRUE(sut.get_flag({"verbose"}));
+    EXPECT_EQ(sut.get_value<std::string>({"name"}), "gr\xc3\xbc\xc3\x9f" "e");
+    ASSERT_EQ(sut.get_values({"files"}).size(), 1);
+    EXPECT_EQ(*sut.get_values({"files"}).begin(), "\xf0\x9f\x98\x80.txt");
+
+    // quoting and backslash rules of CommandLineToArgvW, the program name is skipped
+    EXPECT_NO_THROW(sut.parse(L"\"C:\\Program Files\\app.exe\" -n \"a b\" c:\\dir\\ \"x\\\"y\" \\\\\"q r\" \"\"\"\"\"\" \"\""));
+    EXPECT_EQ(sut.get_value<std::string>({"name"}), "a b");
+    std::vector<std::string> files(sut.get_values({"files"}).begin(), sut.get_values({"files"}).end());
+    EXPECT_EQ(files, (std::vector<std::string>{"c:\\dir\\", "x\"y", "\\q r", "\"\"", ""}));
+
+    EXPECT_EQ(sut.try_parse(L"app --name").error, argcpp17_exception::err_missing_value);
+    EXPECT_NO_THROW(sut.parse(L"app"));
+    EXPECT_TRUE(sut.get_values({"files"}).empty());
+}